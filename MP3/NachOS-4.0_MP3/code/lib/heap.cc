@@ -0,0 +1,296 @@
+// heap.cc
+//     	Routines to manage a priority queue of "things", kept as a
+//	binary heap in an array.  Element i has children 2i+1 and 2i+2,
+//	and comes out no later than either of them.
+//
+//	The array doubles in size when it fills up, so there is no
+//	limit on the number of items, and no allocation per item.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+const int HeapInitialSize = 16;
+
+//----------------------------------------------------------------------
+// Heap<T>::Heap
+//	Initialize a heap, empty to start with.
+//
+//	"comp" orders the items (NULL: first in, first out)
+//	"place" returns where an item records its position in the heap
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::Heap(int (*comp)(T x, T y), int *(*place)(T x))
+{
+    compare = comp;
+    placeOf = place;
+    maxInHeap = HeapInitialSize;
+    elements = new HeapElement<T>[maxInHeap];
+    numInHeap = 0;
+    nextOrder = 0;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::~Heap
+//	Prepare a heap for deallocation.  This does *NOT* free the
+//	items on the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::~Heap()
+{
+    delete[] elements;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Insert
+//      Put an "item" on the heap, after any items that compare equal
+//	to it.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Insert(T item)
+{
+    HeapElement<T> element;
+
+    ASSERT(!IsInHeap(item));
+    if (numInHeap == maxInHeap)
+    { // full: double the array
+        HeapElement<T> *bigger = new HeapElement<T>[2 * maxInHeap];
+
+        for (int i = 0; i < numInHeap; i++)
+            bigger[i] = elements[i];
+        delete[] elements;
+        elements = bigger;
+        maxInHeap *= 2;
+    }
+    element.item = item;
+    element.order = nextOrder++;
+    Put(numInHeap, element);
+    numInHeap++;
+    SiftUp(numInHeap - 1);
+    ASSERT(IsInHeap(item));
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::RemoveFront
+//      Remove the smallest item from the heap.  Heap must not be empty.
+//
+// Returns:
+//	The removed item.
+//----------------------------------------------------------------------
+
+template <class T>
+T Heap<T>::RemoveFront()
+{
+    T thing = Front();
+
+    Remove(thing);
+    return thing;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Remove
+//      Remove a specific item from the heap.  Must be on the heap!
+//	The last element takes its place, and is moved up or down.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Remove(T item)
+{
+    int i;
+
+    ASSERT(IsInHeap(item));
+    i = *placeOf(item);
+    *placeOf(item) = -1;
+    numInHeap--;
+    if (i < numInHeap)
+    { // fill the hole with the last element
+        T moved = elements[numInHeap].item;
+
+        Put(i, elements[numInHeap]);
+        SiftUp(i);
+        SiftDown(*placeOf(moved));
+    }
+    ASSERT(!IsInHeap(item));
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Changed
+//      The key of "item" has changed (for instance, its priority went
+//	up); restore the heap order.  It keeps its insertion order.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Changed(T item)
+{
+    ASSERT(IsInHeap(item));
+    SiftUp(*placeOf(item));
+    SiftDown(*placeOf(item));
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::IsInHeap
+//      Return TRUE if the item is on the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+bool Heap<T>::IsInHeap(T item)
+{
+    int i = *placeOf(item);
+
+    return (i >= 0 && i < numInHeap && elements[i].item == item);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Apply
+//      Apply function to every item on the heap, in no particular
+//	order.  The function must not change the heap.
+//
+//	"func" -- the function to apply
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Apply(void (*func)(T)) const
+{
+    for (int i = 0; i < numInHeap; i++)
+        (*func)(elements[i].item);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Less
+//	Return TRUE if element i should come out before element j:
+//	it is smaller, or equal and inserted earlier.
+//----------------------------------------------------------------------
+
+template <class T>
+bool Heap<T>::Less(int i, int j) const
+{
+    int c = (compare == NULL) ? 0 : (*compare)(elements[i].item, elements[j].item);
+
+    if (c != 0)
+        return (c < 0);
+    return (elements[i].order < elements[j].order);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Put
+//	Store "element" at position i, and tell the item where it is.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::Put(int i, HeapElement<T> element)
+{
+    elements[i] = element;
+    *placeOf(element.item) = i;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SiftUp
+//	Swap element i with its parent until the parent comes out first.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SiftUp(int i)
+{
+    while (i > 0 && Less(i, (i - 1) / 2))
+    {
+        HeapElement<T> element = elements[i];
+
+        Put(i, elements[(i - 1) / 2]);
+        Put((i - 1) / 2, element);
+        i = (i - 1) / 2;
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SiftDown
+//	Swap element i with its smaller child until neither child
+//	comes out before it.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SiftDown(int i)
+{
+    for (;;)
+    {
+        int child = 2 * i + 1;
+
+        if (child >= numInHeap)
+            break;
+        if (child + 1 < numInHeap && Less(child + 1, child))
+            child++;
+        if (!Less(child, i))
+            break;
+
+        HeapElement<T> element = elements[i];
+
+        Put(i, elements[child]);
+        Put(child, element);
+        i = child;
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SanityCheck
+//      Test whether this is still a legal heap: every element comes
+//	out no earlier than its parent, and knows where it is.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SanityCheck() const
+{
+    ASSERT(numInHeap >= 0 && numInHeap <= maxInHeap);
+    for (int i = 0; i < numInHeap; i++)
+    {
+        ASSERT(*placeOf(elements[i].item) == i);
+        ASSERT(i == 0 || !Less(i, (i - 1) / 2));
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T>
+void Heap<T>::SelfTest(T *p, int numEntries)
+{
+    int i;
+    T *q = new T[numEntries];
+
+    SanityCheck();
+    ASSERT(IsEmpty());
+    for (i = 0; i < numEntries; i++)
+    {
+        Insert(p[i]);
+        ASSERT(IsInHeap(p[i]));
+    }
+    SanityCheck();
+
+    // should come out in order
+    for (i = 0; i < numEntries; i++)
+    {
+        q[i] = RemoveFront();
+        ASSERT(!IsInHeap(q[i]));
+        ASSERT(i == 0 || compare == NULL ||
+               (*compare)(q[i - 1], q[i]) <= 0);
+    }
+    ASSERT(IsEmpty());
+
+    // remove from the middle
+    for (i = 0; i < numEntries; i++)
+        Insert(p[i]);
+    for (i = 0; i < numEntries; i += 2)
+        Remove(p[i]);
+    SanityCheck();
+    while (!IsEmpty())
+        RemoveFront();
+    SanityCheck();
+    delete[] q;
+}
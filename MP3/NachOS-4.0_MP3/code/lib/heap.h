@@ -0,0 +1,104 @@
+// heap.h
+//	Data structures to manage a priority queue, kept as a binary heap.
+//
+//	A heap keeps its smallest item at the front, like a SortedList,
+//	but Insert, RemoveFront and Remove take O(log n) steps instead
+//	of O(n).  Items with equal keys come out in the order they were
+//	put in, so a heap whose compare function always returns 0 (or
+//	is NULL) is a plain FIFO queue.
+//
+//	To find an item quickly (for Remove, or when its key changes),
+//	every item must have room to record where it is in the heap;
+//	the caller provides a function returning the address of that
+//	slot:
+//	   int *Place(T x)
+//	An item can be on only one heap at a time.  Allocation and
+//	deallocation of the items on the heap are to be done by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The following class defines a "heap element" -- an item, plus
+// the order in which it was inserted, to break ties.
+//
+// This class is private to this module.  Made public for notational
+// convenience.
+
+template <class T>
+class HeapElement {
+  public:
+    T item;			// item on the heap
+    int order;			// when it was inserted
+};
+
+// The following class defines a "heap" -- a priority queue whose
+// items are arranged so that RemoveFront always returns the smallest
+// element, and the oldest one among equals.
+// All types to be inserted into a heap must have a "Compare"
+// function defined, as for a SortedList:
+//	   int Compare(T x, T y)
+//		returns -1 if x < y
+//		returns 0 if x == y
+//		returns 1 if x > y
+
+template <class T>
+class Heap {
+  public:
+    Heap(int (*comp)(T x, T y), int *(*place)(T x));
+    				// initialize the heap
+    ~Heap();			// de-allocate the heap
+
+    void Insert(T item);	// Put item on the heap
+    T Front() { ASSERT(!IsEmpty()); return elements[0].item; }
+    				// Return smallest item on heap
+				// without removing it
+    T RemoveFront();		// Take smallest item off the heap
+    void Remove(T item);	// Remove specific item from heap
+    void Changed(T item);	// The key of item has changed; move
+				// it to its proper place
+
+    bool IsInHeap(T item);	// is the item on the heap?
+
+    unsigned int NumInHeap() { return numInHeap; };
+    				// how many items on the heap?
+    bool IsEmpty() { return (numInHeap == 0); };
+    				// is the heap empty?
+    T Item(int i) { ASSERT(i >= 0 && i < numInHeap);
+		     return elements[i].item; };
+    				// i'th item, in no particular order
+
+    void Apply(void (*f)(T)) const;
+    				// apply function to all elements on heap
+
+    void SanityCheck() const;	// has this heap been corrupted?
+    void SelfTest(T *p, int numEntries);
+				// verify module is working
+
+  private:
+    HeapElement<T> *elements;	// the heap, smallest at [0]
+    int numInHeap;		// number of elements on heap
+    int maxInHeap;		// size of "elements"
+    int nextOrder;		// insertion order of the next item
+
+    int (*compare)(T x, T y);	// function for ordering heap elements
+    int *(*placeOf)(T x);	// where an item records its position
+
+    bool Less(int i, int j) const;
+    				// should element i come out before j?
+    void Put(int i, HeapElement<T> element);
+    				// store element at i, tell the item
+    void SiftUp(int i);		// move element i up to its place
+    void SiftDown(int i);	// move element i down to its place
+};
+
+#include "heap.cc"		// templates are really like macros
+				// so needs to be included in every
+				// file that uses the template
+#endif // HEAP_H
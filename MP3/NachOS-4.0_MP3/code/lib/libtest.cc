@@ -1,6 +1,6 @@
 // libtest.cc 
 //	Driver code to call self-test routines for standard library
-//	classes -- bitmaps, lists, sorted lists, and hash tables.
+//	classes -- bitmaps, lists, sorted lists, heaps and hash tables.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -11,6 +11,7 @@
 #include "bitmap.h"
 #include "list.h"
 #include "hash.h"
+#include "heap.h"
 #include "sysdep.h"
 
 //----------------------------------------------------------------------
@@ -53,6 +54,86 @@ HashKey(char *str) {
 // Array of values to be inserted into a List or SortedList. 
 static int listTestVector[] = { 9, 5, 7 };
 
+// # of items in the heap order test: more than fit in a new heap
+static const int HeapTestSize = 40;
+
+//----------------------------------------------------------------------
+// HeapPlace
+//	Return where an integer records its position in a heap.  Serves
+//	as the place function for testing Heaps (of integers
+//	0..HeapTestSize-1).
+//----------------------------------------------------------------------
+
+static int heapPlaces[HeapTestSize];
+
+static int *
+HeapPlace(int x) {
+    return &heapPlaces[x];
+}
+
+//----------------------------------------------------------------------
+// HeapKeyCompare
+//	Compare two integers by their keys in "heapKeys", which may be
+//	equal for different integers.  Serves as the comparison function
+//	for testing the order of Heaps.
+//----------------------------------------------------------------------
+
+static int heapKeys[HeapTestSize];
+
+static int
+HeapKeyCompare(int x, int y) {
+    return IntCompare(heapKeys[x], heapKeys[y]);
+}
+
+//----------------------------------------------------------------------
+// HeapOrderTest
+//	Test what the scheduler relies on Heaps for: that they grow past
+//	their initial size, that items with equal keys come out first in,
+//	first out, and that an item whose key changes (Changed) moves to
+//	its new place.
+//----------------------------------------------------------------------
+
+static void
+HeapOrderTest() {
+    Heap<int> *heap = new Heap<int>(HeapKeyCompare, HeapPlace);
+    int i, prev, item;
+
+    // five keys, each shared by eight items
+    for (i = 0; i < HeapTestSize; i++) {
+	heapKeys[i] = i % 5;
+	heap->Insert(i);
+    }
+    heap->SanityCheck();
+    ASSERT(heap->NumInHeap() == HeapTestSize);
+
+    // by key, and by insertion order among equal keys
+    prev = heap->RemoveFront();
+    for (i = 1; i < HeapTestSize; i++) {
+	item = heap->RemoveFront();
+	ASSERT(heapKeys[prev] < heapKeys[item] ||
+	       (heapKeys[prev] == heapKeys[item] && prev < item));
+	prev = item;
+    }
+    ASSERT(heap->IsEmpty());
+
+    // raise one key to the front, and drop the front one to the back
+    for (i = 0; i < HeapTestSize; i++)
+	heap->Insert(i);
+    heapKeys[37] = -1;
+    heap->Changed(37);
+    ASSERT(heap->Front() == 37);
+    heapKeys[37] = 100;
+    heap->Changed(37);
+    ASSERT(heap->Front() == 0);
+    heap->SanityCheck();
+    for (i = 0; i < HeapTestSize - 1; i++)
+	ASSERT(heap->RemoveFront() != 37);
+    ASSERT(heap->RemoveFront() == 37);
+    ASSERT(heap->IsEmpty());
+
+    delete heap;
+}
+
 // Array of values to be inserted into the HashTable
 // There are enough here to force a ReHash().
 static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
@@ -60,7 +141,7 @@ static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and 
+//	Run self tests on bitmaps, lists, sorted lists, heaps and
 //	hash tables.
 //----------------------------------------------------------------------
 
@@ -69,6 +150,7 @@ LibSelfTest () {
     Bitmap *map = new Bitmap(200);
     List<int> *list = new List<int>;
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
+    Heap<int> *heap = new Heap<int>(IntCompare, HeapPlace);
     HashTable<int, char *> *hashTable = 
 	new HashTable<int, char *>(HashKey, HashInt);
 	
@@ -76,10 +158,13 @@ LibSelfTest () {
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
+    heap->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
+    HeapOrderTest();
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector)/sizeof(char *));
 
     delete map;
     delete list;
     delete sortList;
+    delete heap;
     delete hashTable;
 }
@@ -33,6 +33,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <cerrno>
+#include <pthread.h>
 
 #ifdef SOLARIS
 // KMS
@@ -570,3 +571,78 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
     // This may mask other kinds of failures, but it is the
     // right thing to do in the common case.
 }
+
+//----------------------------------------------------------------------
+// RunInParallel
+// 	Call func(args[i]) for each i in 0..n-1, each on a host thread of
+//	its own, and return once every call has returned.  The calling
+//	thread does args[0]; the rest go to a pool of host threads,
+//	started the first time they are needed and kept from then on, so
+//	that calling this often is cheap.
+//
+//	The calls must not touch any data shared with each other, or
+//	with the Nachos kernel: none of Nachos is thread-safe.
+//----------------------------------------------------------------------
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poolWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t poolDone = PTHREAD_COND_INITIALIZER;
+static int poolSize = 0;		// # of host threads in the pool
+static void (*poolFunc)(void *);	// the calls to make
+static void **poolArgs;
+static int poolNext = 0;		// next call to hand out
+static int poolCount = 0;		// # of calls
+static int poolLeft = 0;		// # of calls still running
+
+static void *
+PoolThread(void *dummy)
+{
+    pthread_mutex_lock(&poolLock);
+    for (;;) {
+	while (poolNext >= poolCount)
+	    pthread_cond_wait(&poolWork, &poolLock);
+	int i = poolNext++;
+	pthread_mutex_unlock(&poolLock);
+	(*poolFunc)(poolArgs[i]);
+	pthread_mutex_lock(&poolLock);
+	if (--poolLeft == 0)
+	    pthread_cond_signal(&poolDone);
+    }
+    return NULL;
+}
+
+void
+RunInParallel(void (*func)(void *), void **args, int n)
+{
+    ASSERT(n >= 1);
+    if (n == 1) {
+	(*func)(args[0]);
+	return;
+    }
+    pthread_mutex_lock(&poolLock);
+    while (poolSize < n - 1) {
+	pthread_t thread;
+
+	if (pthread_create(&thread, NULL, PoolThread, NULL) != 0) {
+	    cerr << "Cannot start a host thread\n";
+	    Abort();
+	}
+	pthread_detach(thread);
+	poolSize++;
+    }
+    poolFunc = func;
+    poolArgs = args;
+    poolCount = n;
+    poolNext = 1;			// args[0] is ours
+    poolLeft = n - 1;
+    pthread_cond_broadcast(&poolWork);
+    pthread_mutex_unlock(&poolLock);
+
+    (*func)(args[0]);
+
+    pthread_mutex_lock(&poolLock);
+    while (poolLeft > 0)
+	pthread_cond_wait(&poolDone, &poolLock);
+    poolCount = poolNext = 0;
+    pthread_mutex_unlock(&poolLock);
+}
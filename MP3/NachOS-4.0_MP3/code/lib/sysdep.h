@@ -37,6 +37,10 @@ extern unsigned int RandomNumber();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Run func(args[i]) for each of the n args, each on a host thread
+// of its own (the caller's among them); return when all are done
+extern void RunInParallel(void (*func)(void *), void **args, int n);
+
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
@@ -193,6 +193,21 @@ Interrupt::YieldOnReturn()
     yieldOnReturn = TRUE; 
 }
 
+//----------------------------------------------------------------------
+// Interrupt::NextPending
+// 	Return the time the next pending interrupt is due, or -1 if no
+//	interrupt is pending.  Until then, only the CPU can change
+//	anything.
+//----------------------------------------------------------------------
+
+int
+Interrupt::NextPending()
+{
+    if (pending->IsEmpty())
+	return -1;
+    return pending->Front()->when;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Idle
 // 	Routine called when there is nothing in the ready queue.
@@ -239,6 +254,7 @@ Interrupt::Halt()
     cout << "Machine halting!\n\n";
     cout << "This is halt\n";
     kernel->stats->Print();
+    kernel->scheduler->PrintCpus();
     delete kernel;	// Never returns.
 }
 /*
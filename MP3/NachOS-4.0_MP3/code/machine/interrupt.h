@@ -106,6 +106,8 @@ class Interrupt {
  
     void YieldOnReturn();	// cause a context switch on return 
 				// from an interrupt handler
+    int NextPending();		// when the next interrupt is due;
+    				// -1 if there is none
 
     MachineStatus getStatus() { return status; } 
     void setStatus(MachineStatus st) { status = st; }
@@ -72,9 +72,31 @@ Machine::Machine(bool debug)
 #endif
 
     singleStep = debug;
+    second = FALSE;
+    trapped = FALSE;
     CheckEndian();
 }
 
+//----------------------------------------------------------------------
+// Machine::Machine
+// 	Initialize a second CPU, for running user code outside the
+//	Nachos kernel, in RunFor.  It has registers of its own, but
+//	shares main memory with "shared"; it always uses a page table.
+//----------------------------------------------------------------------
+
+Machine::Machine(Machine *shared)
+{
+    for (int i = 0; i < NumTotalRegs; i++)
+        registers[i] = 0;
+    mainMemory = shared->mainMemory;
+    tlb = NULL;
+    pageTable = NULL;
+    pageTableSize = 0;
+    singleStep = FALSE;
+    second = TRUE;
+    trapped = FALSE;
+}
+
 //----------------------------------------------------------------------
 // Machine::~Machine
 // 	De-allocate the data structures used to simulate user program execution.
@@ -82,7 +104,8 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
-    delete [] mainMemory;
+    if (!second)
+        delete [] mainMemory;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -100,6 +123,10 @@ Machine::~Machine()
 void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
+    if (second) {			// leave it to the real thing
+	trapped = TRUE;
+	return;
+    }
     DEBUG(dbgMach, "Exception: " << exceptionNames[which]);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
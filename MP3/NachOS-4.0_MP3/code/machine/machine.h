@@ -95,16 +95,27 @@ class Machine {
   public:
     Machine(bool debug);	// Initialize the simulation of the hardware
 				// for running user programs
+    Machine(Machine *shared);	// A second CPU, sharing the memory of
+				// "shared", to run user code on a
+				// host thread of its own (see RunFor)
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
     void Run();	 		// Run a user program
+    int RunFor(int numInstructions);
+    				// Run up to "numInstructions" of a
+				// user program, on a second CPU;
+				// stop short of any exception.
+				// Return the # run
 
     int ReadRegister(int num);	// read the contents of a CPU register
 
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    bool IsSingleStepping() { return singleStep; }
+				// is the user program debugger on?
+
 // Data structures accessible to the Nachos kernel -- main memory and the
 // page table/TLB.
 //
@@ -177,6 +188,9 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    bool second;		// a second CPU? (it cannot trap to the
+				// kernel; RunFor stops instead)
+    bool trapped;		// did RunFor stop at an exception?
 
     friend class Interrupt;		// calls DelayedLoad()    
 };
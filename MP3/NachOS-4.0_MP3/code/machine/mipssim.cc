@@ -81,6 +81,38 @@ void Machine::Run()
 	}
 }
 
+//----------------------------------------------------------------------
+// Machine::RunFor
+// 	Run up to "numInstructions" of the user program whose registers
+//	and page table are loaded, on a second CPU.  Nothing else is
+//	simulated meanwhile -- no clock, no interrupts -- and nothing
+//	outside this machine's registers and the program's memory is
+//	touched, so several can run at once, on different host threads.
+//
+//	An instruction that would trap to the kernel is not run (an
+//	exception leaves the registers as they were), so that the real
+//	machine can run it again, and trap.
+//
+//	Returns the number of instructions run.
+//----------------------------------------------------------------------
+
+int Machine::RunFor(int numInstructions)
+{
+	Instruction instr;
+	int done = 0;
+
+	ASSERT(second);
+	trapped = FALSE;
+	while (done < numInstructions)
+	{
+		OneInstruction(&instr);
+		if (trapped)
+			break;
+		done++;
+	}
+	return done;
+}
+
 //----------------------------------------------------------------------
 // TypeToReg
 // 	Retrieve the register # referred to in an instruction.
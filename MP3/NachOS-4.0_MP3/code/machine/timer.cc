@@ -33,13 +33,18 @@
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
 //      "toCall" is the interrupt handler to call when the timer expires.
+//      "period" is the (average) time between interrupts.
 //----------------------------------------------------------------------
 
-Timer::Timer(bool doRandom, CallBackObj *toCall)
+Timer::Timer(bool doRandom, CallBackObj *toCall, int period)
 {
+    ASSERT(period > 0);
     randomize = doRandom;
     callPeriodically = toCall;
+    this->period = period;
     disable = FALSE;
+    stopped = FALSE;
+    pending = FALSE;
     SetInterrupt();
 }
 
@@ -52,6 +57,8 @@ Timer::Timer(bool doRandom, CallBackObj *toCall)
 void 
 Timer::CallBack() 
 {
+    pending = FALSE;
+
     // invoke the Nachos interrupt handler for this device
     callPeriodically->CallBack();
     
@@ -59,23 +66,38 @@ Timer::CallBack()
     			// decide if it wants to disable future interrupts
 }
 
+//----------------------------------------------------------------------
+// Timer::Start
+//      Undo Stop: generate interrupts again, starting a full period
+//	from now, unless one is already scheduled.
+//----------------------------------------------------------------------
+
+void
+Timer::Start()
+{
+    stopped = FALSE;
+    if (!pending)
+        SetInterrupt();
+}
+
 //----------------------------------------------------------------------
 // Timer::SetInterrupt
 //      Cause a timer interrupt to occur in the future, unless
-//	future interrupts have been disabled.  The delay is either
-//	fixed or random.
+//	future interrupts have been disabled or stopped.  The delay is
+//	either fixed or random.
 //----------------------------------------------------------------------
 
 void
 Timer::SetInterrupt() 
 {
-    if (!disable) {
-       int delay = TimerTicks;
+    if (!disable && !stopped) {
+       int delay = period;
     
        if (randomize) {
-	     delay = 1 + (RandomNumber() % (TimerTicks * 2));
+	     delay = 1 + (RandomNumber() % (period * 2));
         }
        // schedule the next timer device interrupt
        kernel->interrupt->Schedule(this, delay, TimerInt);
+       pending = TRUE;
     }
 }
@@ -6,11 +6,16 @@
 //	having a thread go to sleep for a specific period of time. 
 //
 //	We emulate a hardware timer by scheduling an interrupt to occur
-//	every time stats->totalTicks has increased by TimerTicks.
+//	every time stats->totalTicks has increased by TimerTicks, or by
+//	the period the timer was programmed with.
 //
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	The timer can be stopped and started again, as a one-shot timer
+//	would be for a tickless kernel: once stopped, the interrupt
+//	already scheduled is the last one until it is started.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
@@ -27,20 +32,27 @@
 // The following class defines a hardware timer. 
 class Timer : public CallBackObj {
   public:
-    Timer(bool doRandom, CallBackObj *toCall);
+    Timer(bool doRandom, CallBackObj *toCall, int period);
 				// Initialize the timer, and callback to "toCall"
-				// every time slice.
+				// every "period" ticks.
     virtual ~Timer() {}
     
     void Disable() { disable = TRUE; }
     				// Turn timer device off, so it doesn't
 				// generate any more interrupts.
+    void Stop() { stopped = TRUE; }
+    				// Don't generate interrupts after the
+				// one already scheduled, until Start
+    void Start();		// Generate interrupts again
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
-    CallBackObj *callPeriodically; // call this every TimerTicks time units 
+    CallBackObj *callPeriodically; // call this every "period" time units 
+    int period;			// (average) time between interrupts
     bool disable;		// turn off the timer device after next
     				// interrupt.
+    bool stopped;		// ditto, until started again
+    bool pending;		// is an interrupt scheduled?
     
     void CallBack();		// called internally when the hardware
 				// timer generates an interrupt
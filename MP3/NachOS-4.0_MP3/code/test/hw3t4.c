@@ -0,0 +1,39 @@
+#include "syscall.h"
+
+#define NumWorkers 4
+
+/* Each worker sums 1..100 and exits with the sum. */
+void
+Worker()
+{
+	int i, sum = 0;
+	for (i = 1; i <= 100; ++i) {
+		sum += i;
+		if (i % 25 == 0)
+			ThreadYield();
+	}
+	ThreadExit(sum);
+}
+
+int
+main()
+{
+	ThreadId workers[NumWorkers];
+	int n, code, failed = 0;
+
+	for (n = 0; n < NumWorkers; ++n) {
+		workers[n] = ThreadFork(Worker);
+		if (workers[n] < 0)
+			failed = 1;
+	}
+	for (n = 0; n < NumWorkers; ++n) {
+		code = ThreadJoin(workers[n]);
+		PrintInt(code);
+		if (code != 5050)
+			failed = 1;
+	}
+	if (ThreadJoin(workers[0]) != -1)	/* joined already */
+		failed = 1;
+	PrintInt(failed);
+	Exit(failed);
+}
@@ -18,17 +18,23 @@
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to
 //		occur at random, instead of fixed, intervals.
+//      "period" -- the (average) time between interrupts.
+//      "tickless" -- if true, stop the timer while no thread is
+//		waiting to run.
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom)
+Alarm::Alarm(bool doRandom, int period, bool tickless)
 {
-    timer = new Timer(doRandom, this);
+    this->tickless = tickless;
+    stopped = FALSE;
+    timer = new Timer(doRandom, this, period);
 }
 
 //----------------------------------------------------------------------
 // Alarm::CallBack
 //	Software interrupt handler for the timer device. The timer device is
-//	set up to interrupt the CPU periodically (once every TimerTicks).
+//	set up to interrupt the CPU periodically (once every TimerTicks,
+//	unless set otherwise with -tick).
 //	This routine is called each time there is a timer interrupt,
 //	with interrupts disabled.
 //
@@ -47,13 +53,34 @@ void Alarm::CallBack()
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
-    kernel->scheduler->DoAgeThreeQueue();
 
-    if (status != IdleMode)
+    // the scheduling policy decides whether to time-slice
+    if (kernel->scheduler->Tick(status == IdleMode, status == UserMode))
+        interrupt->YieldOnReturn();
+
+    // nobody to switch to: no point in ticking until somebody is
+    if (tickless && kernel->scheduler->NumReady() == 0 &&
+        kernel->scheduler->NumBusy() <= 1)
     {
-        int curThreadLevel = kernel->currentThread->GetLevel();
-        bool L1empty = kernel->scheduler->CheckL1();
+        DEBUG(dbgInt, "Nothing ready; stopping the timer");
+        timer->Stop();
+        stopped = TRUE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::ThreadReady
+//	Called, with interrupts disabled, whenever a thread is put on
+//	the ready list.  In tickless mode, the timer may have been
+//	stopped; start it, so the new thread gets its turn.
+//----------------------------------------------------------------------
 
-        if(!L1empty || curThreadLevel == 3) interrupt->YieldOnReturn();
+void Alarm::ThreadReady()
+{
+    if (stopped)
+    {
+        DEBUG(dbgInt, "A thread is ready; starting the timer");
+        timer->Start();
+        stopped = FALSE;
     }
 }
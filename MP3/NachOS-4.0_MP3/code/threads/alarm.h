@@ -8,6 +8,11 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
+//	In tickless mode (-tickless), the timer is stopped while no
+//	thread is waiting to run (and no other CPU is running one),
+//	since there is then nothing to time-slice, and started again
+//	when a thread becomes ready.
+//
 //	NOTE: this abstraction is not completely implemented.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
@@ -25,15 +30,20 @@
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
-				// to "toCall" every time slice.
+    Alarm(bool doRandomYield, int period, bool tickless);
+    				// Initialize the timer, and callback 
+				// to "toCall" every "period" ticks.
     ~Alarm() { delete timer; }
     
     void WaitUntil(int x);	// suspend execution until time > now + x
                                 // this method is not yet implemented
+    void ThreadReady();		// A thread was put on the ready list;
+    				// restart the timer if it is stopped
 
   private:
     Timer *timer;		// the hardware timer device
+    bool tickless;		// stop the timer when nothing is ready?
+    bool stopped;		// is the timer stopped?
 
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
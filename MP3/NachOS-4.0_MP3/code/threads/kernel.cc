@@ -28,11 +28,20 @@
 Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE;
+    schedPolicy = "mlfq";
+    slice = new TimeSlice();
+    timerPeriod = TimerTicks;
+    tickless = FALSE;
+    numCpus = 1;
+    parallel = FALSE;
     debugUserProg = FALSE;
     consoleIn = NULL;  // default is stdin
     consoleOut = NULL; // default is stdout
-    for(int i=0; i<10; i++) Threadpriority[i] = 0;
-    
+    threadTable = new ThreadTable();
+    execfile = new char *[argc]; // there can't be more than this
+    execPriority = new int[argc];
+    execfileNum = 0;
+
     // init
     for (int i=0;i<NumPhysPages;i++) PageUsed[i] = 0;
     freepages = NumPhysPages;
@@ -56,17 +65,61 @@ Kernel::Kernel(int argc, char **argv)
         {
             debugUserProg = TRUE;
         }
+        else if (strcmp(argv[i], "-sched") == 0)
+        {
+            ASSERT(i + 1 < argc);
+            schedPolicy = argv[++i];
+        }
+        else if (strcmp(argv[i], "-tick") == 0)
+        {
+            ASSERT(i + 1 < argc);
+            timerPeriod = atoi(argv[++i]);
+            ASSERT(timerPeriod > 0);
+        }
+        else if (strcmp(argv[i], "-quantum") == 0)
+        {
+            ASSERT(i + 1 < argc);
+            slice->SetQuantum(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-quanta") == 0)
+        {
+            ASSERT(i + 3 < argc);
+            for (int level = 1; level <= 3; level++)
+                slice->SetQuantum(level, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-adaptive") == 0)
+        {
+            slice->SetAdaptive(TRUE);
+        }
+        else if (strcmp(argv[i], "-tickless") == 0)
+        {
+            tickless = TRUE;
+        }
+        else if (strcmp(argv[i], "-smp") == 0)
+        {
+            ASSERT(i + 1 < argc);
+            numCpus = atoi(argv[++i]);
+            ASSERT(numCpus >= 1);
+        }
+        else if (strcmp(argv[i], "-parallel") == 0)
+        {
+            parallel = TRUE;
+        }
         else if (strcmp(argv[i], "-e") == 0)
         {
-            execfile[++execfileNum] = argv[++i];
-            cout << execfile[execfileNum] << "\n";
+            ASSERT(i + 1 < argc);
+            execfile[execfileNum] = argv[++i];
+            execPriority[execfileNum] = 0;
+            cout << execfile[execfileNum++] << "\n";
         }
         else if (strcmp(argv[i], "-ep") == 0)
         {
-            execfile[++execfileNum] = argv[++i];
+            ASSERT(i + 2 < argc);
+            execfile[execfileNum] = argv[++i];
             char *str = argv[++i];
-            Threadpriority[execfileNum] = atoi(str);
-            ASSERT(Threadpriority[execfileNum] >= 0 && Threadpriority[execfileNum] <= 149);
+            execPriority[execfileNum] = atoi(str);
+            ASSERT(execPriority[execfileNum] >= 0 && execPriority[execfileNum] <= 149);
+            execfileNum++;
         }
         else if (strcmp(argv[i], "-ci") == 0)
         {
@@ -102,6 +155,9 @@ Kernel::Kernel(int argc, char **argv)
         {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
             cout << "Partial usage: nachos [-s]\n";
+            cout << "Partial usage: nachos [-sched mlfq|rr|stride|cfs]\n";
+            cout << "Partial usage: nachos [-tick #] [-quantum #] [-quanta # # #] [-adaptive]\n";
+            cout << "Partial usage: nachos [-tickless] [-smp # [-parallel]]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-nf]\n";
@@ -124,13 +180,14 @@ void Kernel::Initialize()
     // But if it ever tries to give up the CPU, we better have a Thread
     // object to save its state.
 
-    currentThread = new Thread("main", threadNum++);
+    currentThread = new Thread("main", threadTable->Allocate());
+    threadTable->Enter(currentThread);
     currentThread->setStatus(RUNNING);
 
     stats = new Statistics();       // collect statistics
     interrupt = new Interrupt;      // start up interrupt handling
-    scheduler = new Scheduler();    // initialize the ready queue
-    alarm = new Alarm(randomSlice); // start up time slicing
+    scheduler = new Scheduler(schedPolicy, slice, numCpus, parallel, timerPeriod); // initialize the ready queue
+    alarm = new Alarm(randomSlice, timerPeriod, tickless); // start up time slicing
     machine = new Machine(debugUserProg);
     synchConsoleIn = new SynchConsoleInput(consoleIn);    // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
@@ -162,6 +219,9 @@ Kernel::~Kernel()
     delete synchConsoleOut;
     delete synchDisk;
     delete fileSystem;
+    delete threadTable;
+    delete[] execfile;
+    delete[] execPriority;
     // delete postOfficeIn;
     // delete postOfficeOut;
 
@@ -288,25 +348,31 @@ void ForkExecute(Thread *t)
     t->space->Execute(t->getName());
 }
 
+void ForkUserThread(Thread *t)
+{
+    t->space->ExecuteThread(t);
+}
+
 void Kernel::ExecAll()
 {
-    for (int i = 1; i <= execfileNum; i++)
+    for (int i = 0; i < execfileNum; i++)
     {
-        int a = Exec(execfile[i]);
+        int a = Exec(execfile[i], execPriority[i]);
     }
     currentThread->Finish();
     //Kernel::Exec();
 }
 
-int Kernel::Exec(char *name)
+int Kernel::Exec(char *name, int priority)
 {
-    t[threadNum] = new Thread(name, threadNum);
-    t[threadNum]->SetPriority(Threadpriority[threadNum]);
-    t[threadNum]->space = new AddrSpace(PageUsed, &freepages);
-    t[threadNum]->Fork((VoidFunctionPtr)&ForkExecute, (void *)t[threadNum]);
-    threadNum++;
+    Thread *t = new Thread(name, threadTable->Allocate());
+
+    threadTable->Enter(t);
+    t->SetPriority(priority);
+    t->space = new AddrSpace(PageUsed, &freepages);
+    t->Fork((VoidFunctionPtr)&ForkExecute, (void *)t);
 
-    return threadNum - 1;
+    return t->getID();
 
     // cout << "Total threads number is " << execfileNum << endl;
     // for (int n=1;n<=execfileNum;n++) {
@@ -334,3 +400,30 @@ int Kernel::Exec(char *name)
     //    Kernel::Run();
     //  cout << "after ThreadedKernel:Run();" << endl;  // unreachable
 }
+
+//----------------------------------------------------------------------
+// Kernel::ThreadFork
+// 	Fork a thread to run the user procedure at "func", in the
+//	address space of the current thread, with the same priority.
+//	Returns its ThreadId in that address space, or -1 if there is
+//	no memory left for its stack.
+//----------------------------------------------------------------------
+
+int Kernel::ThreadFork(int func)
+{
+    AddrSpace *space = currentThread->space;
+    Thread *t = new Thread(currentThread->getName(), threadTable->Allocate());
+    int id;
+
+    threadTable->Enter(t);
+    t->space = space;
+    id = space->ForkThread(t, func);
+    if (id < 0)
+    {
+        delete t;
+        return -1;
+    }
+    t->SetPriority(currentThread->GetPriority());
+    t->Fork((VoidFunctionPtr)&ForkUserThread, (void *)t);
+    return id;
+}
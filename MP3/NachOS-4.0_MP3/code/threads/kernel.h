@@ -12,6 +12,7 @@
 #include "debug.h"
 #include "utility.h"
 #include "thread.h"
+#include "threadtable.h"
 #include "scheduler.h"
 #include "interrupt.h"
 #include "stats.h"
@@ -38,12 +39,13 @@ public:
       // from constructor because
       // refers to "kernel" as a global
   void ExecAll();
-  int Exec(char *name);
+  int Exec(char *name, int priority);
+  int ThreadFork(int func); // fork a thread in the current user program
   void ThreadSelfTest(); // self test of threads and synchronization
 
   void ConsoleTest(); // interactive console self test
   void NetworkTest(); // interactive 2-machine network test
-  Thread *getThread(int threadID) { return t[threadID]; }
+  Thread *getThread(int threadID) { return threadTable->Lookup(threadID); }
 
   void PrintInt(int number);
   int CreateFile(char *filename); // fileSystem call
@@ -57,6 +59,7 @@ public:
   // they're global variables used everywhere.
 
   Thread *currentThread; // the thread holding the CPU
+  ThreadTable *threadTable; // every thread, by ID
   Scheduler *scheduler;  // the ready list
   Interrupt *interrupt;  // interrupt status
   Statistics *stats;     // performance metrics
@@ -72,11 +75,16 @@ public:
   int hostName; // machine identifier
 
 private:
-  Thread *t[10];
-  char *execfile[10];
-  int execfileNum;
-  int threadNum;
+  char **execfile;     // user programs to run (-e, -ep)
+  int *execPriority;  // ... and their priorities
+  int execfileNum;    // # of them
   bool randomSlice;   // enable pseudo-random time slicing
+  char *schedPolicy;  // name of the scheduling policy
+  TimeSlice *slice;   // time slices, for the scheduler
+  int timerPeriod;    // ticks between timer interrupts
+  bool tickless;      // stop the timer when nothing is ready?
+  int numCpus;        // # of simulated CPUs
+  bool parallel;      // run their user code on host threads?
   bool debugUserProg; // single step user program
   double reliability; // likelihood messages are dropped
   char *consoleIn;    // file to read console input from
@@ -84,7 +92,6 @@ private:
 
   int freepages;
   int PageUsed[NumPhysPages];
-  int Threadpriority[10];
 #ifndef FILESYS_STUB
   bool formatFlag; // format the disk if this is true
 #endif
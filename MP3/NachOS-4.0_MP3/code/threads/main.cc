@@ -4,6 +4,9 @@
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -sched <policy> -tick <ticks> -quantum <ticks>
+//              -quanta <L1 ticks> <L2 ticks> <L3 ticks> -adaptive
+//              -tickless -smp <# of CPUs> -parallel
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
 //              -n <network reliability> -m <machine id>
@@ -13,6 +16,15 @@
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -sched selects the scheduling policy: mlfq (the default), rr,
+//	stride or cfs (see schedpolicy.h)
+//    -tick sets the time between timer interrupts (default TimerTicks)
+//    -quantum sets the time slice, in timer interrupts (default 1)
+//    -quanta sets the time slice of each level separately
+//    -adaptive adapts the time slices to the load (see timeslice.h)
+//    -tickless stops the timer while no thread is waiting to run
+//    -smp simulates several CPUs, taking turns (see scheduler.h)
+//    -parallel runs their user code on several host threads
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
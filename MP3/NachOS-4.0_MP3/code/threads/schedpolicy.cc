@@ -0,0 +1,444 @@
+// schedpolicy.cc
+//	Routines for the scheduling policies.  See schedpolicy.h for
+//	what each of them does.
+//
+//	Every policy keeps its ready threads in heaps (see lib/heap.h),
+//	so no operation scans the ready threads.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "schedpolicy.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// ComparePredict, ComparePriority, CompareVirtualTime, ReadyPlace
+//	Functions ordering the ready queues: by approximate burst time,
+//	shortest first; by priority, highest first; by virtual time,
+//	least first.  A queue without an order is FIFO.  ReadyPlace is
+//	where a thread keeps its position in its queue.
+//----------------------------------------------------------------------
+
+static int
+ComparePredict(Thread *x, Thread *y)
+{
+    if (x->GetPredict() < y->GetPredict())
+        return -1;
+    else if (x->GetPredict() > y->GetPredict())
+        return 1;
+    return 0;
+}
+
+static int
+ComparePriority(Thread *x, Thread *y)
+{
+    if (x->GetPriority() > y->GetPriority())
+        return -1;
+    else if (x->GetPriority() < y->GetPriority())
+        return 1;
+    return 0;
+}
+
+static int
+CompareVirtualTime(Thread *x, Thread *y)
+{
+    if (x->GetVirtualTime() < y->GetVirtualTime())
+        return -1;
+    else if (x->GetVirtualTime() > y->GetVirtualTime())
+        return 1;
+    return 0;
+}
+
+static int *
+ReadyPlace(Thread *thread)
+{
+    return thread->ReadyPlace();
+}
+
+//----------------------------------------------------------------------
+// CompareAgeDue, AgePlace
+//	Functions ordering the aging queue: soonest due first.
+//----------------------------------------------------------------------
+
+static int
+CompareAgeDue(Thread *x, Thread *y)
+{
+    if (x->AgeDue() < y->AgeDue())
+        return -1;
+    else if (x->AgeDue() > y->AgeDue())
+        return 1;
+    return 0;
+}
+
+static int *
+AgePlace(Thread *thread)
+{
+    return thread->AgePlace();
+}
+
+//----------------------------------------------------------------------
+// SchedulingPolicy::Create
+// 	Return a new policy of the kind called "name" (see
+//	schedpolicy.h), or NULL if there is no such policy.
+//----------------------------------------------------------------------
+
+SchedulingPolicy *
+SchedulingPolicy::Create(char *name)
+{
+    if (strcmp(name, "mlfq") == 0)
+        return new MultilevelPolicy();
+    else if (strcmp(name, "rr") == 0)
+        return new RoundRobinPolicy();
+    else if (strcmp(name, "stride") == 0)
+        return new StridePolicy();
+    else if (strcmp(name, "cfs") == 0)
+        return new FairPolicy();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// MultilevelPolicy::MultilevelPolicy
+// 	Initialize the three levels, and the aging queue, to empty.
+//----------------------------------------------------------------------
+
+MultilevelPolicy::MultilevelPolicy()
+{
+    L1 = new Heap<Thread *>(ComparePredict, ReadyPlace);
+    L2 = new Heap<Thread *>(ComparePriority, ReadyPlace);
+    L3 = new Heap<Thread *>(NULL, ReadyPlace);
+    aging = new Heap<Thread *>(CompareAgeDue, AgePlace);
+    due = NULL;
+    maxDue = 0;
+}
+
+MultilevelPolicy::~MultilevelPolicy()
+{
+    delete L1;
+    delete L2;
+    delete L3;
+    delete aging;
+    delete [] due;
+}
+
+//----------------------------------------------------------------------
+// MultilevelPolicy::Enqueue
+// 	Put "thread" on the level its priority belongs to, and start
+//	counting its time in queue, for aging.
+//----------------------------------------------------------------------
+
+void MultilevelPolicy::Enqueue(Thread *thread)
+{
+    // Check which level to place
+    int thread_priority = thread->GetPriority();
+
+    if(thread_priority >= 100 && thread_priority <= 149){ // L1
+        InsertToQueue(L1, 1, thread);
+    }
+    else if(thread_priority >= 50 && thread_priority <= 99){ // L2
+        InsertToQueue(L2, 2, thread);
+    }
+    else if(thread_priority >= 0 && thread_priority <= 49){ // L3
+        InsertToQueue(L3, 3, thread);
+    }
+    thread->UpdateAgeBaseline();
+    aging->Insert(thread);
+}
+
+//----------------------------------------------------------------------
+// MultilevelPolicy::PickNext
+// 	Take the front thread of the highest non-empty level.
+//----------------------------------------------------------------------
+
+Thread *
+MultilevelPolicy::PickNext()
+{
+    Heap<Thread *> *queue;
+    int level;
+
+    if(!L1->IsEmpty()){ // the lowest approximate burst time, oldest first
+        queue = L1;
+        level = 1;
+    }
+    else if(!L2->IsEmpty()){ // the highest priority, oldest first
+        queue = L2;
+        level = 2;
+    }
+    else if(!L3->IsEmpty()){
+        queue = L3;
+        level = 3;
+    }
+    else{ // L1, L2, L3 is empty
+        return NULL;
+    }
+
+    Thread* nextThread = queue->Front();
+    aging->Remove(nextThread); // before its time in queue changes
+    nextThread->AddTicksInQueue();
+    return Removethread(queue, level, nextThread);
+}
+
+//----------------------------------------------------------------------
+// MultilevelPolicy::ShouldPreempt
+// 	A thread in L3 is time-sliced; anything else runs until it
+//	blocks, unless a thread is waiting in L1.
+//----------------------------------------------------------------------
+
+bool MultilevelPolicy::ShouldPreempt(Thread *current, bool sliceOver)
+{
+    return (!L1->IsEmpty() || (current->GetLevel() == 3 && sliceOver));
+}
+
+int MultilevelPolicy::NumReady()
+{
+    return L1->NumInHeap() + L2->NumInHeap() + L3->NumInHeap();
+}
+
+Thread* MultilevelPolicy::Removethread(Heap<Thread *> *Readyqueue, int level, Thread* nextThread){
+    Readyqueue->Remove(nextThread);
+    DEBUG(dbgKYL,"[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" <<nextThread->getID() << "] is removed from queue L["<<level <<"]");
+    return nextThread;
+}
+
+void MultilevelPolicy::InsertToQueue(Heap<Thread *> *Readyqueue, int level, Thread* inThread){
+    DEBUG(dbgKYL,"[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" <<inThread->getID() << "] is inserted into queue L["<<level <<"]");
+    Readyqueue->Insert(inThread);
+}
+
+//----------------------------------------------------------------------
+// MultilevelPolicy::Tick
+// 	Age the ready threads that have waited another AgingTicks since
+//	they last aged.  The others are not touched -- their waiting
+//	time is worked out when they age, or when they leave the ready
+//	queues.
+//
+//	The due threads are aged L3 first, then L2, then L1, oldest
+//	first within a level, as when every queue was walked on every
+//	tick; a thread moved up a level is not aged again.  They are
+//	collected in "due", which only grows when there are more ready
+//	threads than ever before, not on every tick.
+//----------------------------------------------------------------------
+
+void MultilevelPolicy::Tick(){
+    double now = kernel->stats->totalTicks;
+    int numDue = 0;
+
+    if(maxDue < (int)aging->NumInHeap()){
+        delete [] due;
+        maxDue = aging->NumInHeap() * 2;
+        due = new Thread *[maxDue];
+    }
+    while(!aging->IsEmpty() && aging->Front()->AgeDue() <= now){
+        due[numDue++] = aging->RemoveFront();
+    }
+    for(int level = 3; level >= 1; level--){
+        for(int i = 0; i < numDue; i++){
+            if(due[i] != NULL && due[i]->GetLevel() == level){
+                AgeThread(due[i]);
+                aging->Insert(due[i]); // due again AgingTicks from now
+                due[i] = NULL;
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// MultilevelPolicy::AgeThread
+// 	"curThread" has waited AgingTicks more: raise its priority,
+//	and move it up a queue if it has outgrown its own.
+//----------------------------------------------------------------------
+
+void MultilevelPolicy::AgeThread(Thread* curThread){
+    int level = curThread->GetLevel();
+
+    curThread->AddTicksInQueue();
+    curThread->UpdateAgeBaseline();
+    if(curThread->HandleAgingOld()){ // check if thread in queue over AgingTicks
+        curThread->SetPriority(10); // add its priority to avoid starvation
+
+        if(level == 3 && curThread->GetPriority() > 49){ // if a L3 thread need to upgrade
+            Removethread(L3, 3, curThread);
+            InsertToQueue(L2, 2, curThread);
+        }
+        else if(level == 2 && curThread->GetPriority() > 99){ // if a L2 thread need to upgrade
+            Removethread(L2, 2, curThread);
+            InsertToQueue(L1, 1, curThread);
+        }
+        else if(level == 2){ // still in L2, but it moves up the queue
+            L2->Changed(curThread);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// RoundRobinPolicy
+// 	One FIFO queue; the running thread is preempted at the end of
+//	its time slice.
+//----------------------------------------------------------------------
+
+RoundRobinPolicy::RoundRobinPolicy()
+{
+    ready = new Heap<Thread *>(NULL, ReadyPlace);
+}
+
+RoundRobinPolicy::~RoundRobinPolicy()
+{
+    delete ready;
+}
+
+void RoundRobinPolicy::Enqueue(Thread *thread)
+{
+    ready->Insert(thread);
+}
+
+Thread *
+RoundRobinPolicy::PickNext()
+{
+    if (ready->IsEmpty())
+        return NULL;
+    return ready->RemoveFront();
+}
+
+bool RoundRobinPolicy::ShouldPreempt(Thread *current, bool sliceOver)
+{
+    return sliceOver;
+}
+
+int RoundRobinPolicy::NumReady()
+{
+    return ready->NumInHeap();
+}
+
+//----------------------------------------------------------------------
+// StridePolicy
+// 	A thread's virtual time is its pass.  A thread joining the
+//	queue (new, or back from sleeping) starts no earlier than the
+//	pass of the last thread picked, so it cannot make up for lost
+//	time by monopolizing the CPU.
+//----------------------------------------------------------------------
+
+// the stride of a thread with one ticket
+const double StrideOne = 1 << 20;
+
+StridePolicy::StridePolicy()
+{
+    ready = new Heap<Thread *>(CompareVirtualTime, ReadyPlace);
+    globalPass = 0;
+}
+
+StridePolicy::~StridePolicy()
+{
+    delete ready;
+}
+
+void StridePolicy::Enqueue(Thread *thread)
+{
+    if (thread->GetVirtualTime() < globalPass)
+        thread->SetVirtualTime(globalPass);
+    ready->Insert(thread);
+}
+
+Thread *
+StridePolicy::PickNext()
+{
+    Thread *thread;
+
+    if (ready->IsEmpty())
+        return NULL;
+    thread = ready->RemoveFront();
+    globalPass = thread->GetVirtualTime();
+    return thread;
+}
+
+void StridePolicy::Charge(Thread *thread, int ticks)
+{
+    double stride = StrideOne / (thread->GetPriority() + 1);
+
+    thread->SetVirtualTime(thread->GetVirtualTime() + stride * ticks);
+}
+
+bool StridePolicy::ShouldPreempt(Thread *current, bool sliceOver)
+{
+    return (sliceOver && !ready->IsEmpty());
+}
+
+int StridePolicy::NumReady()
+{
+    return ready->NumInHeap();
+}
+
+//----------------------------------------------------------------------
+// FairPolicy
+// 	A thread's virtual time is its weighted run time.  Weights come
+//	from the priority, in 15 steps of 10 points; priority 50 has
+//	weight FairWeights[5], and so runs in real time.
+//----------------------------------------------------------------------
+
+static const int FairWeights[15] = {
+    336, 419, 524, 655, 819, 1024, 1280, 1600,
+    2000, 2500, 3125, 3906, 4883, 6104, 7629
+};
+
+FairPolicy::FairPolicy()
+{
+    ready = new Heap<Thread *>(CompareVirtualTime, ReadyPlace);
+    minVirtualTime = 0;
+}
+
+FairPolicy::~FairPolicy()
+{
+    delete ready;
+}
+
+void FairPolicy::Enqueue(Thread *thread)
+{
+    if (thread->GetVirtualTime() < minVirtualTime)
+        thread->SetVirtualTime(minVirtualTime);
+    ready->Insert(thread);
+}
+
+Thread *
+FairPolicy::PickNext()
+{
+    Thread *thread;
+
+    if (ready->IsEmpty())
+        return NULL;
+    thread = ready->RemoveFront();
+    minVirtualTime = max(minVirtualTime, thread->GetVirtualTime());
+    return thread;
+}
+
+void FairPolicy::Charge(Thread *thread, int ticks)
+{
+    thread->SetVirtualTime(thread->GetVirtualTime() + Weigh(thread, ticks));
+}
+
+//----------------------------------------------------------------------
+// FairPolicy::ShouldPreempt
+// 	Preempt "current" once its virtual time, counting the ticks it
+//	has run so far, passes that of the first thread waiting.  Its
+//	time slice is the least it runs once dispatched.
+//----------------------------------------------------------------------
+
+bool FairPolicy::ShouldPreempt(Thread *current, bool sliceOver)
+{
+    int ran = (int)(kernel->stats->totalTicks - current->GetBurstStart());
+
+    if (!sliceOver || ready->IsEmpty())
+        return FALSE;
+    return (current->GetVirtualTime() + Weigh(current, ran) >
+            ready->Front()->GetVirtualTime());
+}
+
+int FairPolicy::NumReady()
+{
+    return ready->NumInHeap();
+}
+
+double FairPolicy::Weigh(Thread *thread, int ticks)
+{
+    return (double)ticks * FairWeights[5] / FairWeights[thread->GetPriority() / 10];
+}
@@ -0,0 +1,152 @@
+// schedpolicy.h
+//	Data structures for the scheduling policies: the rules deciding
+//	which ready thread runs next, and when the running thread should
+//	give up the CPU.
+//
+//	The Scheduler does the mechanism -- marking threads ready,
+//	switching to them, cleaning up after them -- and asks its policy
+//	everything else.  A policy sees a thread when it becomes ready
+//	(Enqueue), when it is chosen to run (PickNext), and when it
+//	stops running (Charge, with the ticks it ran); it also sees every
+//	timer tick (Tick), and decides whether the tick should preempt
+//	the running thread (ShouldPreempt), knowing whether its time
+//	slice is over (see timeslice.h).
+//
+//	The policies are:
+//	    mlfq   -- three-level queue: L1 shortest approximate burst
+//		      first, L2 highest priority first, L3 round robin,
+//		      with aging (the default)
+//	    rr     -- plain round robin
+//	    stride -- stride scheduling, with priority+1 tickets
+//	    cfs    -- fair sharing by weighted virtual run time
+//
+//	Selected with "-sched <name>" on the command line.
+//
+//	All routines are called with interrupts disabled.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SCHEDPOLICY_H
+#define SCHEDPOLICY_H
+
+#include "copyright.h"
+#include "heap.h"
+#include "thread.h"
+
+// The following class defines the interface every policy provides.
+
+class SchedulingPolicy {
+  public:
+    static SchedulingPolicy *Create(char *name);
+    				// The policy called "name", or
+				// NULL if there is none
+    virtual ~SchedulingPolicy() {};
+
+    virtual void Enqueue(Thread *thread) = 0;
+    				// "thread" is ready to run
+    virtual Thread *PickNext() = 0;
+    				// Remove and return the thread to
+				// run next; NULL if none is ready
+    virtual void Charge(Thread *thread, int ticks) {};
+    				// "thread" ran for "ticks"
+    virtual void Tick() {};	// A timer tick went by
+    virtual bool ShouldPreempt(Thread *current, bool sliceOver) = 0;
+    				// Should this tick take the CPU
+				// away from "current"?
+
+    virtual int NumReady() = 0;	// # of threads waiting to run
+};
+
+// The three-level queue of MP3, with aging.
+
+class MultilevelPolicy : public SchedulingPolicy {
+  public:
+    MultilevelPolicy();
+    ~MultilevelPolicy();
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    void Tick();		// Age the threads that are due
+    bool ShouldPreempt(Thread *current, bool sliceOver);
+    int NumReady();
+
+  private:
+    Heap<Thread *> *L1; // priority 100-149, shortest predicted burst first
+    Heap<Thread *> *L2; // priority 50-99, highest priority first
+    Heap<Thread *> *L3; // priority 0-49, first come first served
+    Heap<Thread *> *aging; // every ready thread, soonest to age first
+    Thread **due;	// the threads aging this tick
+    int maxDue;		// size of "due"
+
+    void AgeThread(Thread* curThread);
+    Thread* Removethread(Heap<Thread *> *Readyqueue, int level, Thread* nextThread);
+    void InsertToQueue(Heap<Thread *> *Readyqueue, int level, Thread* inThread);
+};
+
+// Every ready thread takes its turn, one time slice at a time.
+
+class RoundRobinPolicy : public SchedulingPolicy {
+  public:
+    RoundRobinPolicy();
+    ~RoundRobinPolicy();
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    bool ShouldPreempt(Thread *current, bool sliceOver);
+    int NumReady();
+
+  private:
+    Heap<Thread *> *ready;	// unordered, so first in, first out
+};
+
+// Stride scheduling: a thread holds priority+1 tickets; running for
+// a tick advances its "pass" by StrideOne/tickets, and the thread
+// with the lowest pass runs next.  So each gets CPU time in
+// proportion to its tickets, deterministically.
+
+class StridePolicy : public SchedulingPolicy {
+  public:
+    StridePolicy();
+    ~StridePolicy();
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    void Charge(Thread *thread, int ticks);
+    bool ShouldPreempt(Thread *current, bool sliceOver);
+    int NumReady();
+
+  private:
+    Heap<Thread *> *ready;	// lowest pass first
+    double globalPass;		// pass of the last thread picked
+};
+
+// Completely-fair-style scheduling: a thread's virtual run time grows
+// with the ticks it runs, more slowly the higher its priority (its
+// weight grows by a quarter every 10 priority points).  The thread
+// with the least virtual run time runs next, and the running thread
+// is preempted once it is no longer the least, and has had its time
+// slice.  A thread that slept comes back no earlier than the least
+// one ready, so sleeping does not bank CPU time.
+
+class FairPolicy : public SchedulingPolicy {
+  public:
+    FairPolicy();
+    ~FairPolicy();
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    void Charge(Thread *thread, int ticks);
+    bool ShouldPreempt(Thread *current, bool sliceOver);
+    int NumReady();
+
+  private:
+    Heap<Thread *> *ready;	// least virtual run time first
+    double minVirtualTime;	// never decreases
+
+    double Weigh(Thread *thread, int ticks);
+    				// virtual time for running "ticks"
+};
+
+#endif // SCHEDPOLICY_H
@@ -6,14 +6,16 @@
 //	If interrupts are disabled, we can assume mutual exclusion
 //	(since we are on a uniprocessor).
 //
+//	Which ready thread runs next, and when the running thread is
+//	preempted, is up to the scheduling policy (see schedpolicy.h);
+//	the scheduler only keeps it informed.  Each simulated CPU has
+//	a policy of its own, keeping its ready list (see scheduler.h).
+//
 // 	NOTE: We can't use Locks to provide mutual exclusion here, since
 // 	if we needed to wait for a lock, and the lock was busy, we would
 //	end up calling FindNextToRun(), and that would put us in an
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
-//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -23,19 +25,82 @@
 #include "scheduler.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// Cpu::Cpu
+// 	Initialize a simulated CPU: idle, with no ready threads.
+//
+//	"id" is the CPU's number.
+//	"policyName" names the scheduling policy (see schedpolicy.h).
+//----------------------------------------------------------------------
+
+Cpu::Cpu(int id, char *policyName)
+{
+    this->id = id;
+    policy = SchedulingPolicy::Create(policyName);
+    if (policy == NULL)
+    {
+        cerr << "Unknown scheduling policy: " << policyName << "\n";
+        Abort();
+    }
+    current = NULL;
+    sliceTicks = 0;
+    preempting = FALSE;
+    inUser = FALSE;
+    machine = NULL;
+    window = 0;
+    busyTicks = idleTicks = numSwitches = numSteals = 0;
+}
+
+Cpu::~Cpu()
+{
+    delete policy;
+    if (machine != NULL)
+        delete machine;
+}
+
+//----------------------------------------------------------------------
+// Cpu::Print
+// 	Print the statistics of this CPU.
+//----------------------------------------------------------------------
+
+void Cpu::Print()
+{
+    cout << "CPU " << id << ": ticks busy " << busyTicks << ", idle "
+         << idleTicks << "; switches " << numSwitches << ", steals "
+         << numSteals << "\n";
+}
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
-//	Initially, no ready threads.
+//	Initially, no ready threads; the first CPU runs the current
+//	thread, and the others are idle.
+//
+//	"policyName" names the scheduling policy (see schedpolicy.h).
+//	"slice" gives the time slices; the scheduler de-allocates it.
+//	"numCpus" is the number of simulated CPUs.
+//	"parallel" is set to run their user code in parallel.
+//	"timerPeriod" is the time between timer interrupts (-tick).
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(char *policyName, TimeSlice *slice, int numCpus,
+                     bool parallel, int timerPeriod)
 {
-    //readyList = new List<Thread *>;
-    L1 = new List<Thread *>;
-    L2 = new List<Thread *>;
-    L3 = new List<Thread *>;
+    ASSERT(numCpus >= 1);
+    this->numCpus = numCpus;
+    cpus = new Cpu *[numCpus];
+    for (int i = 0; i < numCpus; i++)
+        cpus[i] = new Cpu(i, policyName);
+    running = new Cpu *[numCpus];
+    host = 0;
+    cpus[host]->current = kernel->currentThread;
+    rotating = FALSE;
+    this->parallel = parallel;
+    this->timerPeriod = timerPeriod;
+    tickInUser = FALSE;
+    lastTick = kernel->stats->totalTicks;
     toBeDestroyed = NULL;
+    this->slice = slice;
 }
 
 //----------------------------------------------------------------------
@@ -45,16 +110,22 @@ Scheduler::Scheduler()
 
 Scheduler::~Scheduler()
 {
-    //delete readyList;
-    delete L1;
-    delete L2;
-    delete L3;
+    for (int i = 0; i < numCpus; i++)
+        delete cpus[i];
+    delete[] cpus;
+    delete[] running;
+    delete slice;
 }
 
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
 //	Put it on the ready list, for later scheduling onto the CPU.
+//	If it is the running thread (it is yielding), first charge it
+//	for the time it ran.  The timer may have been stopped while
+//	nothing was ready (see alarm.h); have it started again.
+//
+//	The thread goes on the ready list of the CPU readying it.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -64,28 +135,18 @@ void Scheduler::ReadyToRun(Thread *thread)
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
     //cout << "Putting thread on ready list: " << thread->getName() << endl ;
+    if (thread == kernel->currentThread)
+        Charge(thread);
     thread->setStatus(READY);
-    
-    // Check which level to place
-    int thread_priority = thread->GetPriority();
-
-    if(thread_priority >= 100 && thread_priority <= 149){ // L1
-        InsertToQueue(L1, 1, thread);
-    }
-    else if(thread_priority >= 50 && thread_priority <= 99){ // L2
-        InsertToQueue(L2, 2, thread);
-    }
-    else if(thread_priority >= 0 && thread_priority <= 49){ // L3
-        InsertToQueue(L3, 3, thread);
-    }
-    //readyList->Append(thread);
-    thread->UpdateAgeBaseline();
+    cpus[host]->policy->Enqueue(thread);
+    kernel->alarm->ThreadReady();
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
 // 	Return the next thread to be scheduled onto the CPU.
-//	If there are no ready threads, return NULL.
+//	If there are no ready threads, try to steal one from another
+//	CPU; failing that, return NULL.
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -94,95 +155,308 @@ Thread *
 Scheduler::FindNextToRun()
 {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
-    
-    if(!L1->IsEmpty()){
-        ListIterator<Thread*> *iter = new ListIterator<Thread*>(L1); // In list.h has tutorial
-
-        Thread *lowest = L1->Front(); // take the front of queue to be the lowest burst time Thread first
-        double min_appro_burst = lowest->GetPredict(); // GetPredict() can get the approximate burst time
-
-        for (; !iter->IsDone(); iter->Next()) {
-            double appro_burst = iter->Item()->GetPredict(); // iter->Item() will get the thread in queue
-            if(appro_burst < min_appro_burst){
-                min_appro_burst = appro_burst;
-                lowest = iter->Item();
-            }
-        }
-        lowest->AddTicksInQueue();
-        return Removethread(L1, 1, lowest);
-    }
-    else if(!L2->IsEmpty()){
-        ListIterator<Thread*> *iter = new ListIterator<Thread*> (L2);
-
-        Thread* highest = L2->Front();
-        int high_p = highest->GetPriority();
-        for (; !iter->IsDone(); iter->Next()) {
-            Thread* tmp_thread = iter->Item();
-            int p = tmp_thread->GetPriority();
-            if(p > high_p){
-                high_p = p;
-                highest = iter->Item();
-            }
-        }
-        highest->AddTicksInQueue();
-        return Removethread(L2, 2, highest);
-    }
-    else if(!L3->IsEmpty()){
-        L3->Front()->AddTicksInQueue();
-        return Removethread(L3, 3, L3->Front());
+
+    Thread *thread = cpus[host]->policy->PickNext();
+
+    if (thread == NULL && numCpus > 1)
+        thread = Steal();
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Steal
+// 	Take the thread the CPU with the most ready threads would run
+//	next, for the CPU whose turn it is.  Return NULL if no CPU
+//	has a ready thread.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Steal()
+{
+    Cpu *victim = NULL;
+    Thread *thread;
+
+    for (int i = 0; i < numCpus; i++)
+    {
+        if (cpus[i]->policy->NumReady() > 0 &&
+            (victim == NULL ||
+             cpus[i]->policy->NumReady() > victim->policy->NumReady()))
+            victim = cpus[i];
     }
-    else{ // L1, L2, L3 is empty
+    if (victim == NULL)
         return NULL;
+
+    thread = victim->policy->PickNext();
+    cpus[host]->numSteals++;
+    DEBUG(dbgThread, "CPU " << host << " steals " << thread->getName()
+                            << " from CPU " << victim->id);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Tick
+// 	Called on every timer tick, with interrupts disabled.  Return
+//	TRUE if the running thread should give up the CPU -- the policy
+//	decides, knowing whether its time slice is over -- or if another
+//	CPU has work and should get its turn (see NextCpu).
+//
+//	"idle" is set if no thread is running.
+//	"inUser" is set if it is running user code.
+//----------------------------------------------------------------------
+
+bool Scheduler::Tick(bool idle, bool inUser)
+{
+    Thread *current = kernel->currentThread;
+    Cpu *cpu = cpus[host];
+    int now = kernel->stats->totalTicks;
+
+    for (int i = 0; i < numCpus; i++)
+    {
+        cpus[i]->policy->Tick();
+        if (cpus[i]->current != NULL)
+            cpus[i]->busyTicks += now - lastTick;
+        else
+            cpus[i]->idleTicks += now - lastTick;
     }
-    // if (readyList->IsEmpty())
-    // {
-    //     return NULL;
-    // }
-    // else
-    // {
-    //     return readyList->RemoveFront();
-    // }
+    lastTick = now;
+    slice->Tick();
+
+    rotating = FALSE;
+    tickInUser = inUser;
+    if (idle)
+        return FALSE;
+    cpu->sliceTicks++;
+    cpu->preempting = cpu->policy->ShouldPreempt(current,
+                                                 cpu->sliceTicks >= slice->Quantum(current));
+    rotating = (numCpus > 1 && (NumBusy() > 1 || NumReady() > 0));
+    return (cpu->preempting || rotating);
 }
 
-Thread* Scheduler::Removethread(List<Thread *> *Readyqueue, int level, Thread* nextThread){
-    Readyqueue->Remove(nextThread);
-    DEBUG(dbgKYL,"[B] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" <<nextThread->getID() << "] is removed from queue L["<<level <<"]");
-    return nextThread;
+//----------------------------------------------------------------------
+// Scheduler::NextCpu
+// 	Called by the running thread when it yields.  If the last timer
+//	tick found another CPU with work, hand the host over to the next
+//	such CPU, first giving it a thread to run if it is idle; we
+//	return when it is our CPU's turn again.
+//
+//	In parallel mode, first run the CPUs in user code up to the next
+//	interrupt (see RunWindow); the turn then goes only to a CPU that
+//	needs the host: one in the kernel, or stopped in the window.
+//
+//	Return TRUE if the running thread should still give up its CPU
+//	-- it is preempted, or yielding of its own accord.
+//----------------------------------------------------------------------
+
+bool Scheduler::NextCpu()
+{
+    Thread *oldThread = kernel->currentThread;
+    int me = host;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (!rotating)
+        return TRUE;
+    rotating = FALSE;
+    if (parallel)
+    {
+        cpus[me]->inUser = (tickInUser && !cpus[me]->preempting);
+        RunWindow();
+    }
+
+    for (int n = 1; n < numCpus; n++)
+    {
+        int i = (me + n) % numCpus;
+        Cpu *cpu = cpus[i];
+
+        if (cpu->current != NULL && cpu->inUser)
+            continue; // runs in the next window, in parallel
+        if (cpu->current == NULL)
+        { // idle: find it something to run
+            host = i;
+            Thread *thread = FindNextToRun();
+
+            host = me;
+            if (thread == NULL)
+                continue;
+            thread->setBurstStart();
+            Dispatch(cpu, thread);
+        }
+        DEBUG(dbgThread, "CPU " << me << " hands over to CPU " << i);
+        host = i;
+        Switch(oldThread, cpu->current);
+        break; // our turn again
+    }
+    cpus[host]->inUser = FALSE; // the host runs it
+    return cpus[host]->preempting;
 }
 
-void Scheduler::InsertToQueue(List<Thread *> *Readyqueue, int level, Thread* inThread){
-    DEBUG(dbgKYL,"[A] Tick ["<< kernel->stats->totalTicks <<"]: Thread [" <<inThread->getID() << "] is inserted into queue L["<<level <<"]");
-    Readyqueue->Append(inThread);
+//----------------------------------------------------------------------
+// RunCpu
+// 	Run the user code of a CPU for its window.  Called on a host
+//	thread of its own, so it must not touch the kernel.
+//----------------------------------------------------------------------
+
+static void
+RunCpu(void *arg)
+{
+    Cpu *cpu = (Cpu *)arg;
+
+    cpu->window = cpu->machine->RunFor(cpu->window);
 }
 
-void Scheduler::DoAgeThreeQueue(){ // Age the thread in different level queue
-    AgeQueue(L3, 3);
-    AgeQueue(L2, 2);
-    AgeQueue(L1, 1);
+//----------------------------------------------------------------------
+// Scheduler::RunWindow
+// 	Run the user code of every CPU left in it -- the host's own
+//	included, when the tick found it there -- in parallel, up to the
+//	next pending interrupt, then move the clock on to it.  Only one
+//	CPU per address space takes part, so that no two share memory.
+//
+//	The outcome is merged one CPU at a time, in order.  A CPU stopped
+//	short of a trap, or whose time slice is over, is left for the
+//	host (see NextCpu).
+//----------------------------------------------------------------------
+
+void Scheduler::RunWindow()
+{
+    Statistics *stats = kernel->stats;
+    int next = kernel->interrupt->NextPending();
+    int window = (next < 0) ? timerPeriod : next - stats->totalTicks;
+    int numRunning = 0;
+
+    // the debugging output of user code, printed per instruction,
+    // would come out jumbled; and the debugger steps one CPU at a time
+    if (window <= 0 || kernel->machine->tlb != NULL ||
+        debug->IsEnabled(dbgMach) || debug->IsEnabled(dbgTraCode) ||
+        debug->IsEnabled(dbgAddr) || kernel->machine->IsSingleStepping())
+        return;
+
+    for (int i = 0; i < numCpus; i++)
+    {
+        Cpu *cpu = cpus[i];
+        Thread *thread = cpu->current;
+        bool shared = FALSE;
+
+        if (thread == NULL || !cpu->inUser || thread->space == NULL)
+            continue;
+        for (int j = 0; j < numRunning; j++)
+        {
+            if (running[j]->current->space == thread->space)
+                shared = TRUE;
+        }
+        if (shared)
+            continue;
+
+        if (cpu->machine == NULL)
+            cpu->machine = new Machine(kernel->machine);
+        if (i == host)
+            thread->SaveUserState(); // its registers are in the machine
+        thread->RestoreUserState(cpu->machine);
+        thread->space->RestoreState(cpu->machine);
+        cpu->window = window;
+        running[numRunning++] = cpu;
+    }
+    if (numRunning == 0)
+        return;
+
+    DEBUG(dbgThread, numRunning << " CPUs run " << window << " ticks in parallel");
+    RunInParallel(RunCpu, (void **)running, numRunning);
+
+    for (int j = 0; j < numRunning; j++)
+    {
+        Cpu *cpu = running[j];
+        Thread *thread = cpu->current;
+
+        thread->SaveUserState(cpu->machine);
+        stats->userTicks += cpu->window;
+        if (cpu == cpus[host])
+            thread->RestoreUserState(); // back into the machine
+        else
+        {
+            cpu->sliceTicks++;
+            if (cpu->policy->ShouldPreempt(thread, cpu->sliceTicks >= slice->Quantum(thread)))
+                cpu->preempting = TRUE;
+        }
+        if (cpu->window < window || cpu->preempting)
+            cpu->inUser = FALSE; // needs the host
+    }
+    stats->totalTicks += window;
 }
 
-void Scheduler::AgeQueue(List<Thread *> *Readyqueue, int level){
-     ListIterator<Thread*> *iter = new ListIterator<Thread*> (Readyqueue);
-     Thread* curThread;
-     // Age every thread in queue
-     for (; !iter->IsDone(); iter->Next()){
-        curThread = iter->Item();
-
-        curThread->AddTicksInQueue();
-        curThread->UpdateAgeBaseline();
-        if(curThread->HandleAgingOld()){ // check if thread in queue over 1500 ticks
-            curThread->SetPriority(10); // add its priority to avoid starvation
-
-            if(level == 3 && curThread->GetPriority() > 49){ // if a L3 thread need to upgrade
-                Removethread(L3, 3, curThread);
-                InsertToQueue(L2, 2, curThread);
-            }
-            else if(level == 2 && curThread->GetPriority() > 99){ // if a L2 thread need to upgrade
-                Removethread(L2, 2, curThread);
-                InsertToQueue(L1, 1, curThread);
+//----------------------------------------------------------------------
+// Scheduler::OtherCpu
+// 	Called by a thread giving up its CPU (see Thread::Sleep) when
+//	the CPU has nothing else to run: it goes idle.  If another CPU
+//	is running a thread, hand the host over to it, and return TRUE
+//	once the thread that called us is dispatched again.  Otherwise,
+//	return FALSE at once.
+//
+//	"finishing" is set if the current thread is to be deleted
+//----------------------------------------------------------------------
+
+bool Scheduler::OtherCpu(bool finishing)
+{
+    Thread *oldThread = kernel->currentThread;
+
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    cpus[host]->current = NULL;
+    for (int n = 1; n < numCpus; n++)
+    {
+        int i = (host + n) % numCpus;
+
+        if (cpus[i]->current != NULL)
+        {
+            if (finishing)
+            {
+                ASSERT(toBeDestroyed == NULL);
+                toBeDestroyed = oldThread;
             }
+            DEBUG(dbgThread, "CPU " << host << " is idle; on to CPU " << i);
+            host = i;
+            Switch(oldThread, cpus[i]->current);
+            return TRUE;
         }
-     }
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::NumReady, Scheduler::NumBusy
+// 	Return the number of threads on the ready lists of all CPUs,
+//	and the number of CPUs running a thread.
+//----------------------------------------------------------------------
+
+int Scheduler::NumReady()
+{
+    int num = 0;
+
+    for (int i = 0; i < numCpus; i++)
+        num += cpus[i]->policy->NumReady();
+    return num;
+}
+
+int Scheduler::NumBusy()
+{
+    int num = 0;
+
+    for (int i = 0; i < numCpus; i++)
+    {
+        if (cpus[i]->current != NULL)
+            num++;
+    }
+    return num;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Tell the policy how long "thread" ran, since it was last
+//	dispatched.  Called when the running thread stops: from
+//	ReadyToRun if it yields, from Thread::Sleep if it blocks.
+//----------------------------------------------------------------------
+
+void Scheduler::Charge(Thread *thread)
+{
+    cpus[host]->policy->Charge(thread, (int)(kernel->stats->totalTicks - thread->GetBurstStart()));
 }
 
 //----------------------------------------------------------------------
@@ -214,6 +488,46 @@ void Scheduler::Run(Thread *nextThread, bool finishing)
         toBeDestroyed = oldThread;
     }
 
+    Dispatch(cpus[host], nextThread); // nextThread is now running
+
+    DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
+    DEBUG(dbgKYL, "[E] Tick ["<<kernel->stats->totalTicks << "]: Thread ["<<nextThread->getID() << "] is now selected for execution, thread ["<<oldThread->getID() << "] is replaced, and it has executed ["<<oldThread->GetExecTime() << "] ticks");
+    nextThread->setBurstStart();
+    Switch(oldThread, nextThread);
+    oldThread->setBurstStart();
+    // we're back, running oldThread
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Dispatch
+// 	Make "thread" the running thread of "cpu", starting a new time
+//	slice.
+//----------------------------------------------------------------------
+
+void Scheduler::Dispatch(Cpu *cpu, Thread *thread)
+{
+    slice->Switched(cpu->preempting);
+    cpu->sliceTicks = 0;
+    cpu->preempting = FALSE;
+    cpu->inUser = FALSE;
+    cpu->current = thread;
+    cpu->numSwitches++;
+    thread->setStatus(RUNNING);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Switch
+// 	Hand the host over from oldThread to nextThread, which must be
+//	the running thread of the CPU whose turn it is.  Save the state
+//	of the old thread, and load the state of the new thread, by
+//	calling the machine dependent context switch routine, SWITCH.
+//	Returns when oldThread is handed the host again.
+//----------------------------------------------------------------------
+
+void Scheduler::Switch(Thread *oldThread, Thread *nextThread)
+{
+    ASSERT(cpus[host]->current == nextThread);
+
     if (oldThread->space != NULL)
     {                               // if this thread is a user program,
         oldThread->SaveUserState(); // save the user's CPU registers
@@ -224,17 +538,12 @@ void Scheduler::Run(Thread *nextThread, bool finishing)
                                 // had an undetected stack overflow
 
     kernel->currentThread = nextThread; // switch to the next thread
-    nextThread->setStatus(RUNNING);     // nextThread is now running
 
-    DEBUG(dbgThread, "Switching from: " << oldThread->getName() << " to: " << nextThread->getName());
-    DEBUG(dbgKYL, "[E] Tick ["<<kernel->stats->totalTicks << "]: Thread ["<<nextThread->getID() << "] is now selected for execution, thread ["<<oldThread->getID() << "] is replaced, and it has executed ["<<oldThread->GetExecTime() << "] ticks");
     // This is a machine-dependent assembly language routine defined
     // in switch.s.  You may have to think
     // a bit to figure out what happens after this, both from the point
     // of view of the thread and from the perspective of the "outside world".
-    nextThread->setBurstStart();
     SWITCH(oldThread, nextThread);
-    oldThread->setBurstStart();
     // we're back, running oldThread
 
     // interrupts are off when we return from switch!
@@ -270,4 +579,18 @@ void Scheduler::CheckToBeDestroyed()
     }
 }
 
-//--------------------------------------------------------
\ No newline at end of file
+//--------------------------------------------------------
+
+//----------------------------------------------------------------------
+// Scheduler::PrintCpus
+// 	Print the statistics of each simulated CPU, if there are
+//	several.
+//----------------------------------------------------------------------
+
+void Scheduler::PrintCpus()
+{
+    if (numCpus == 1)
+        return;
+    for (int i = 0; i < numCpus; i++)
+        cpus[i]->Print();
+}
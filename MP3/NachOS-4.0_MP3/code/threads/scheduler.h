@@ -2,6 +2,31 @@
 //	Data structures for the thread dispatcher and scheduler.
 //	Primarily, the list of threads that are ready to run.
 //
+//	With "-smp <n>", we simulate n CPUs.  Each has its own ready
+//	list and its own running thread.  There is still one host
+//	thread and one register file, so the CPUs take turns on them:
+//	at every timer tick, the simulator moves on to the next CPU
+//	with work, saving the registers of the thread it leaves.  A
+//	thread made ready goes on the list of the CPU that readied it,
+//	and a CPU with nothing to run steals a thread from the CPU
+//	with the longest list.
+//
+//	One simulated clock is shared by all the CPUs.  So a thread's
+//	run time includes the turns of the other CPUs, as it would if
+//	they really ran at the same time.
+//
+//	With "-parallel" as well, the CPUs that were running user code
+//	at a timer tick all run it at once, each on a host thread of its
+//	own, up to the next pending interrupt: until then, nothing but
+//	the CPUs themselves can change anything, and each program only
+//	touches its own memory.  The clock then moves on to that
+//	interrupt, which the host handles as usual.  A CPU whose program
+//	traps (a system call, say) stops short of the trap; as does one
+//	whose time slice is over.  These, and the CPUs in the kernel,
+//	still get the host in turn, to run the kernel one at a time.
+//	The outcome depends only on the instructions run, not on the
+//	host's timing, so runs can be repeated.
+//
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -12,46 +37,108 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "schedpolicy.h"
+#include "timeslice.h"
 
-// The following class defines the scheduler/dispatcher abstraction -- 
-// the data structures and operations needed to keep track of which 
-// thread is running, and which threads are ready but not running.
+// The following class defines one simulated CPU: its ready list, the
+// thread it is running, and statistics about it.  The fields are
+// public, as in Statistics.
 
-class Scheduler {
+class Cpu {
   public:
-    Scheduler();		// Initialize list of ready threads 
-    ~Scheduler();		// De-allocate ready list
+    Cpu(int id, char *policyName);	// An idle CPU, with an empty
+				// ready list kept by the named policy
+    ~Cpu();
 
-    void DoAgeThreeQueue();
+    int id;			// 0 .. # of CPUs - 1
+    SchedulingPolicy *policy;	// keeps the threads that are ready
+				// to run on this CPU
+    Thread *current;		// running thread; NULL if idle
+    int sliceTicks;		// timer ticks "current" has had
+				// since it was dispatched
+    bool preempting;		// is "current" about to be preempted?
+    bool inUser;		// was "current" left in user code, so
+				// that it can run in parallel?
+    Machine *machine;		// to run it on, in parallel; NULL
+				// until first needed
+    int window;			// # of instructions to run in
+				// parallel, then # run
 
-    void AgeQueue(List<Thread *> *Readyqueue, int level);
+    int busyTicks;		// time spent running a thread
+    int idleTicks;		// time spent with nothing to run
+    int numSwitches;		// # of threads dispatched
+    int numSteals;		// # of them taken from another CPU
 
-    Thread* Removethread(List<Thread *> *Readyqueue, int level, Thread* nextThread);
+    void Print();		// Print the statistics
+};
 
-    void InsertToQueue(List<Thread *> *Readyqueue, int level, Thread* inThread);
+// The following class defines the scheduler/dispatcher abstraction -- 
+// the data structures and operations needed to keep track of which 
+// thread is running, and which threads are ready but not running.
 
-    bool CheckL1(){return L1->IsEmpty();};
+class Scheduler {
+  public:
+    Scheduler(char *policyName, TimeSlice *slice, int numCpus,
+              bool parallel, int timerPeriod);
+    				// Initialize list of ready threads,
+				// kept by the named policy, for
+				// each of "numCpus" CPUs
+    ~Scheduler();		// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	
     				// Thread can be dispatched.
     Thread* FindNextToRun();	// Dequeue first thread on the ready 
 				// list, if any, and return thread.
+				// Steals from another CPU if need be
     void Run(Thread* nextThread, bool finishing);
     				// Cause nextThread to start running
     void CheckToBeDestroyed();// Check if thread that had been
     				// running needs to be deleted
+    bool Tick(bool idle, bool inUser);
+    				// A timer tick; should the running
+    				// thread be preempted, or another
+				// CPU get its turn?
+    bool NextCpu();		// Give the other CPUs their turn;
+    				// should the running thread still
+				// be preempted?
+    bool OtherCpu(bool finishing);
+    				// Nothing for this CPU to run; move
+				// on to another CPU that is running
+				// a thread, if any
+    int NumReady();		// # of threads on the ready lists
+    int NumBusy();		// # of CPUs running a thread
+    void Charge(Thread *thread);	// The running thread is stopping;
+    				// tell the policy how long it ran
     void Print();		// Print contents of ready list
+    void PrintCpus();		// Print the statistics of each CPU
     
     // SelfTest for scheduler is implemented in class Thread
     
   private:
-    //List<Thread *> *readyList;  // queue of threads that are ready to run,
-				// but not running
-    List<Thread *> *L1; // priority 100-149
-    List<Thread *> *L2; // priority 50-99
-    List<Thread *> *L3; // priority 0-49
+    Cpu **cpus;			// the simulated CPUs
+    int numCpus;
+    Cpu **running;		// the CPUs taking part in a window
+				// (see RunWindow)
+    int host;			// the CPU whose turn it is; its
+				// "current" is kernel->currentThread
+    bool rotating;		// is it another CPU's turn?
+    bool parallel;		// run user code in parallel?
+    int timerPeriod;		// ticks between timer interrupts
+    bool tickInUser;		// did the last tick find the host
+				// running user code?
+    int lastTick;		// time of the last timer tick
     Thread *toBeDestroyed;	// finishing thread to be destroyed
     				// by the next thread that runs
+    TimeSlice *slice;		// how long threads may run
+
+    Thread *Steal();		// Take a thread from the CPU with
+    				// the most ready threads
+    void Dispatch(Cpu *cpu, Thread *thread);
+    				// Make "thread" the one "cpu" runs
+    void RunWindow();		// Run the CPUs in user code in
+    				// parallel, to the next interrupt
+    void Switch(Thread *oldThread, Thread *nextThread);
+    				// Hand the host over to nextThread
 };
 
 #endif // SCHEDULER_H
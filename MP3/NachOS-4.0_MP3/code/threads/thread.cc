@@ -25,6 +25,48 @@
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
 
+// Stacks and Thread objects of dead threads are kept for reuse, so
+// that creating a thread usually needs neither a fresh guarded stack
+// (a host mmap and mprotect, then page faults as it is first touched)
+// nor a trip to the heap.  These are the most we keep of each.
+const int MaxFreeStacks = 16;
+const int MaxFreeThreads = 16;
+
+static int *freeStacks[MaxFreeStacks];	// guarded stacks, ready to reuse
+static int numFreeStacks = 0;
+static void *freeThreads[MaxFreeThreads]; // storage for Thread objects
+static int numFreeThreads = 0;
+
+//----------------------------------------------------------------------
+// Thread::operator new
+// 	Allocate storage for a Thread, reusing that of a dead thread
+//	if there is one.
+//----------------------------------------------------------------------
+
+void *Thread::operator new(size_t size)
+{
+    ASSERT(size == sizeof(Thread));
+    if (numFreeThreads > 0)
+        return freeThreads[--numFreeThreads];
+    return ::operator new(size);
+}
+
+//----------------------------------------------------------------------
+// Thread::operator delete
+// 	Keep the storage of a deleted Thread for the next one, unless
+//	we already have enough.
+//----------------------------------------------------------------------
+
+void Thread::operator delete(void *p)
+{
+    if (p == NULL)
+        return;
+    if (numFreeThreads < MaxFreeThreads)
+        freeThreads[numFreeThreads++] = p;
+    else
+        ::operator delete(p);
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -41,6 +83,10 @@ Thread::Thread(char *threadName, int threadID)
     BurstStart = 0.0;
     Predict = 0.0;
     TicksInQueue = 0;
+    priority = 0;
+    readyPlace = -1;
+    agePlace = -1;
+    VirtualTime = 0.0;
     ID = threadID;
     name = threadName;
     stackTop = NULL;
@@ -71,7 +117,12 @@ Thread::~Thread()
 {
     DEBUG(dbgThread, "Deleting thread: " << name);
     ASSERT(this != kernel->currentThread);
-    if (stack != NULL)
+    kernel->threadTable->Remove(this); // free up our ID
+    if (stack == NULL)
+        return;
+    if (numFreeStacks < MaxFreeStacks)
+        freeStacks[numFreeStacks++] = stack; // keep it for the next thread
+    else
         DeallocBoundedArray((char *)stack, StackSize * sizeof(int));
 }
 
@@ -192,6 +243,10 @@ void Thread::Finish()
 //	Otherwise returns when the thread eventually works its way
 //	to the front of the ready list and gets re-scheduled.
 //
+//	With several CPUs, the timer may only mean another CPU's turn
+//	has come (see Scheduler::NextCpu); then the thread keeps its
+//	CPU, and returns when its CPU's turn comes back.
+//
 //	NOTE: we disable interrupts, so that looking at the thread
 //	on the front of the ready list, and switching to it, can be done
 //	atomically.  On return, we re-set the interrupt level to its
@@ -208,6 +263,11 @@ void Thread::Yield()
 
     DEBUG(dbgThread, "Yielding thread: " << name);
 
+    if (!kernel->scheduler->NextCpu())
+    { // not preempted: carry on
+        (void)kernel->interrupt->SetLevel(oldLevel);
+        return;
+    }
     kernel->scheduler->ReadyToRun(this);
     nextThread = kernel->scheduler->FindNextToRun();
     if (nextThread != NULL)
@@ -231,7 +291,8 @@ void Thread::Yield()
 //	we have no thread to run.  "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run).  With several CPUs, we first give the host to
+//	another CPU that is running a thread, if there is one.
 //
 //	NOTE: we assume interrupts are already disabled, because it
 //	is called from the synchronization routines which must
@@ -250,11 +311,14 @@ void Thread::Sleep(bool finishing)
     DEBUG(dbgTraCode, "In Thread::Sleep, Sleeping thread: " << name << ", " << kernel->stats->totalTicks);
     
     status = BLOCKED;
+    kernel->scheduler->Charge(this);
     NowBurst += kernel->stats->totalTicks - BurstStart;
     CalPredictBurst();
     //cout << "debug Thread::Sleep " << name << "wait for Idle\n";
     while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL)
     {
+        if (kernel->scheduler->OtherCpu(finishing))
+            return; // we've been woken up, and dispatched again
         kernel->interrupt->Idle(); // no one to run, wait for an interrupt
     }
     // returns when it's time for us to run
@@ -270,8 +334,8 @@ void Thread::CalPredictBurst(){
 }
 
 bool Thread::HandleAgingOld(){
-    bool over = (TicksInQueue >= 1500);
-    if(over) TicksInQueue -= 1500;
+    bool over = (TicksInQueue >= AgingTicks);
+    if(over) TicksInQueue -= AgingTicks;
     return over;
 }
 
@@ -356,13 +420,20 @@ PLabelToAddr(void *plabel)
 //		calls (*func)(arg)
 //		calls Thread::Finish
 //
+//	The stack of a dead thread is reused if there is one; its
+//	guard pages are still in place, and everything we rely on in it
+//	is written again below.
+//
 //	"func" is the procedure to be forked
 //	"arg" is the parameter to be passed to the procedure
 //----------------------------------------------------------------------
 
 void Thread::StackAllocate(VoidFunctionPtr func, void *arg)
 {
-    stack = (int *)AllocBoundedArray(StackSize * sizeof(int));
+    if (numFreeStacks > 0)
+        stack = freeStacks[--numFreeStacks];
+    else
+        stack = (int *)AllocBoundedArray(StackSize * sizeof(int));
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
@@ -429,9 +500,14 @@ void Thread::StackAllocate(VoidFunctionPtr func, void *arg)
 //----------------------------------------------------------------------
 
 void Thread::SaveUserState()
+{
+    SaveUserState(kernel->machine);
+}
+
+void Thread::SaveUserState(Machine *machine)
 {
     for (int i = 0; i < NumTotalRegs; i++)
-        userRegisters[i] = kernel->machine->ReadRegister(i);
+        userRegisters[i] = machine->ReadRegister(i);
 }
 
 //----------------------------------------------------------------------
@@ -444,9 +520,14 @@ void Thread::SaveUserState()
 //----------------------------------------------------------------------
 
 void Thread::RestoreUserState()
+{
+    RestoreUserState(kernel->machine);
+}
+
+void Thread::RestoreUserState(Machine *machine)
 {
     for (int i = 0; i < NumTotalRegs; i++)
-        kernel->machine->WriteRegister(i, userRegisters[i]);
+        machine->WriteRegister(i, userRegisters[i]);
 }
 
 //----------------------------------------------------------------------
@@ -56,6 +56,9 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 const int StackSize = (8 * 1024); // in words
 
+// # of ticks a thread waits in a ready queue for each rise in priority
+const int AgingTicks = 1500;
+
 // Thread state
 enum ThreadStatus
 {
@@ -91,6 +94,8 @@ public:
                                          // NOTE -- thread being deleted
                                          // must not be running when delete
                                          // is called
+  void *operator new(size_t size);       // reuses the storage of
+  void operator delete(void *p);         // deleted threads
 
   // basic thread operations
 
@@ -120,7 +125,15 @@ public:
   bool HandleAgingOld();
   void CalPredictBurst();
   double GetPredict(){return Predict;};
+  int *ReadyPlace(){return &readyPlace;}; // where it is in its ready queue
+  int *AgePlace(){return &agePlace;};     // ... and in the aging queue
+  double AgeDue(){return AgeBaseline + AgingTicks - TicksInQueue;};
+                                          // when it next ages, if it
+                                          // is still waiting
   void setBurstStart();
+  double GetBurstStart(){return BurstStart;};
+  double GetVirtualTime(){return VirtualTime;}; // for stride and cfs
+  void SetVirtualTime(double t){VirtualTime = t;};
   double GetExecTime();
 
 private:
@@ -149,10 +162,15 @@ private:
   double BurstStart;
   double Predict;
   double AccuExecTime;
+  int readyPlace;
+  double VirtualTime;
+  int agePlace;
 
 public:
   void SaveUserState();    // save user-level register state
   void RestoreUserState(); // restore user-level register state
+  void SaveUserState(Machine *machine);    // ditto, from/to a
+  void RestoreUserState(Machine *machine); // second CPU
 
   AddrSpace *space; // User code this thread is running.
 };
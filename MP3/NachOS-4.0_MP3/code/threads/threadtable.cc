@@ -0,0 +1,112 @@
+// threadtable.cc
+//	Routines to keep track of the threads by ID.  See threadtable.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "threadtable.h"
+
+const int ThreadTableInitialSize = 16;
+
+//----------------------------------------------------------------------
+// ThreadTable::ThreadTable
+// 	Initialize an empty table.
+//----------------------------------------------------------------------
+
+ThreadTable::ThreadTable()
+{
+    maxIds = ThreadTableInitialSize;
+    table = new Thread *[maxIds];
+    freeIds = new int[maxIds];
+    for (int i = 0; i < maxIds; i++)
+        table[i] = NULL;
+    numFree = numIds = numThreads = 0;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::~ThreadTable
+// 	De-allocate the table, but not the threads in it.
+//----------------------------------------------------------------------
+
+ThreadTable::~ThreadTable()
+{
+    delete[] table;
+    delete[] freeIds;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Allocate
+// 	Return an ID for a new thread: one handed back by a thread that
+//	is gone if there is one, otherwise the next new one, doubling
+//	the table if it is full.
+//----------------------------------------------------------------------
+
+int ThreadTable::Allocate()
+{
+    if (numFree > 0)
+        return freeIds[--numFree];
+
+    if (numIds == maxIds)
+    { // full: double the table
+        Thread **bigger = new Thread *[2 * maxIds];
+
+        for (int i = 0; i < maxIds; i++)
+            bigger[i] = table[i];
+        for (int i = maxIds; i < 2 * maxIds; i++)
+            bigger[i] = NULL;
+        delete[] table;
+        table = bigger;
+        delete[] freeIds; // empty, since we got here
+        freeIds = new int[2 * maxIds];
+        maxIds *= 2;
+    }
+    return numIds++;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Enter
+// 	Record "thread" under its ID.
+//----------------------------------------------------------------------
+
+void ThreadTable::Enter(Thread *thread)
+{
+    int id = thread->getID();
+
+    ASSERT(id >= 0 && id < numIds && table[id] == NULL);
+    table[id] = thread;
+    numThreads++;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Remove
+// 	"thread" is being deleted: take it out of the table, and let
+//	the next thread have its ID.  Threads that were created without
+//	being entered (the self tests, for instance) are not in the
+//	table, and are left alone.
+//----------------------------------------------------------------------
+
+void ThreadTable::Remove(Thread *thread)
+{
+    int id = thread->getID();
+
+    if (id < 0 || id >= numIds || table[id] != thread)
+        return;
+    table[id] = NULL;
+    freeIds[numFree++] = id;
+    numThreads--;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Lookup
+// 	Return the thread with "id", or NULL if there is none.
+//----------------------------------------------------------------------
+
+Thread *ThreadTable::Lookup(int id)
+{
+    if (id < 0 || id >= numIds)
+        return NULL;
+    return table[id];
+}
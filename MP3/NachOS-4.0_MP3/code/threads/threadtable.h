@@ -0,0 +1,50 @@
+// threadtable.h
+//	Data structures to find a thread by its ID.
+//
+//	The kernel gives every thread it creates an ID, and enters the
+//	thread in the table under that ID, so that looking a thread up
+//	is just indexing an array.  When the thread is deleted, its ID
+//	goes back on a free list, and the next thread gets it; so IDs
+//	stay small, and the table only grows to the most threads that
+//	were ever alive at once.  The table doubles when it fills up, so
+//	there is no fixed limit on the number of threads.
+//
+//	All routines are called with interrupts disabled, or before
+//	there is more than one thread.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef THREADTABLE_H
+#define THREADTABLE_H
+
+#include "copyright.h"
+#include "thread.h"
+
+// The following class defines the table of the threads, by ID.
+
+class ThreadTable {
+  public:
+    ThreadTable();		// An empty table
+    ~ThreadTable();		// Does *NOT* delete the threads
+
+    int Allocate();		// An ID nobody is using
+    void Enter(Thread *thread);	// Record "thread" under its ID, which
+    				// must come from Allocate
+    void Remove(Thread *thread);// "thread" is going away; free its ID
+    				// (if it is in the table at all)
+    Thread *Lookup(int id);	// The thread with "id", or NULL
+
+    int NumThreads() { return numThreads; }
+
+  private:
+    Thread **table;		// the thread with each ID, or NULL
+    int *freeIds;		// IDs handed back, to reuse first
+    int numFree;		// # of IDs on freeIds
+    int numIds;			// IDs 0..numIds-1 have been handed out
+    int maxIds;			// size of table and freeIds
+    int numThreads;		// # of threads in the table
+};
+
+#endif // THREADTABLE_H
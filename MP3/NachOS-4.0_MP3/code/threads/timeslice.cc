@@ -0,0 +1,115 @@
+// timeslice.cc
+//	Routines to work out the time slice of a thread, and to adapt
+//	the time slices to the load.  See timeslice.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "timeslice.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// TimeSlice::TimeSlice
+// 	Initialize every quantum to one tick, with no adaptation.
+//----------------------------------------------------------------------
+
+TimeSlice::TimeSlice()
+{
+    for (int i = 0; i < 4; i++)
+        quantum[i] = 1;
+    adaptive = FALSE;
+    scale = 0;
+    numTicks = numSwitches = numPreempted = 0;
+    lastTotalTicks = lastSystemTicks = 0;
+}
+
+//----------------------------------------------------------------------
+// TimeSlice::SetQuantum
+// 	Set the quantum of the threads in "level" (1-3), or of all of
+//	them (level 0), to "ticks" timer interrupts.
+//----------------------------------------------------------------------
+
+void TimeSlice::SetQuantum(int level, int ticks)
+{
+    ASSERT(level >= 0 && level <= 3);
+    ASSERT(ticks >= 1);
+    if (level == 0)
+    {
+        for (int i = 1; i <= 3; i++)
+            quantum[i] = ticks;
+    }
+    else
+    {
+        quantum[level] = ticks;
+    }
+}
+
+//----------------------------------------------------------------------
+// TimeSlice::Quantum
+// 	Return the number of timer ticks "thread" may run before its
+//	time slice is over: the quantum of its level, scaled.
+//----------------------------------------------------------------------
+
+int TimeSlice::Quantum(Thread *thread)
+{
+    int ticks = quantum[thread->GetLevel()];
+
+    if (scale >= 0)
+        ticks <<= scale;
+    else
+        ticks >>= -scale;
+    return max(ticks, 1);
+}
+
+//----------------------------------------------------------------------
+// TimeSlice::Switched
+// 	Count a context switch; "preempted" is set if the thread that
+//	was running used up its time slice (otherwise it blocked).
+//----------------------------------------------------------------------
+
+void TimeSlice::Switched(bool preempted)
+{
+    numSwitches++;
+    if (preempted)
+        numPreempted++;
+}
+
+//----------------------------------------------------------------------
+// TimeSlice::Tick
+// 	Called on every timer tick.  In adaptive mode, every
+//	AdaptInterval ticks, lengthen the time slices if context
+//	switches are eating the CPU, or shorten them if the load is
+//	interactive.
+//----------------------------------------------------------------------
+
+void TimeSlice::Tick()
+{
+    Statistics *stats = kernel->stats;
+
+    if (!adaptive || ++numTicks < AdaptInterval)
+        return;
+
+    int totalTicks = stats->totalTicks - lastTotalTicks;
+    int systemTicks = stats->systemTicks - lastSystemTicks;
+    int oldScale = scale;
+
+    // system ticks per switch, against ticks between switches
+    if (numSwitches > 0 && systemTicks * 100 > HighOverhead * totalTicks)
+        scale = min(scale + 1, 3);
+    else if (numPreempted > 0 && 2 * numPreempted < numSwitches)
+        scale = max(scale - 1, -2);
+    if (scale != oldScale)
+    {
+        DEBUG(dbgThread, "Time slices scaled by 2^" << scale << ": "
+              << numSwitches << " switches (" << numPreempted
+              << " preempted), " << systemTicks << " of " << totalTicks
+              << " ticks in the system");
+    }
+
+    numTicks = numSwitches = numPreempted = 0;
+    lastTotalTicks = stats->totalTicks;
+    lastSystemTicks = stats->systemTicks;
+}
@@ -0,0 +1,70 @@
+// timeslice.h
+//	Data structures for deciding how long a thread may run before
+//	it is time-sliced.
+//
+//	A quantum is counted in timer interrupts ("ticks" of the timer,
+//	whose period is set with -tick).  Each priority band -- the
+//	levels L1 (100-149), L2 (50-99) and L3 (0-49) -- has its own
+//	quantum, one tick unless set with -quantum or -quanta.  Whether
+//	a thread whose quantum is over really gives up the CPU is still
+//	up to the scheduling policy; the multilevel policy, for one,
+//	only time-slices L3.
+//
+//	In adaptive mode (-adaptive), every AdaptInterval ticks we look
+//	at how the CPU was spent.  If the system ticks per context
+//	switch are more than HighOverhead percent of the time between
+//	switches, switching costs too much: all quanta are doubled.  If
+//	instead most switches were threads blocking on their own, the
+//	load is interactive, and slicing the rest finer lets the
+//	interactive threads in sooner: all quanta are halved.  Quanta
+//	stay between 1/4 and 8 times their configured length, and never
+//	below one tick.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TIMESLICE_H
+#define TIMESLICE_H
+
+#include "copyright.h"
+#include "thread.h"
+
+// # of timer ticks between adaptations
+const int AdaptInterval = 16;
+
+// percentage of CPU time spent switching, above which quanta grow
+const int HighOverhead = 50;
+
+// The following class defines the time slices of the threads.
+
+class TimeSlice {
+  public:
+    TimeSlice();		// Every quantum one tick, not adaptive
+
+    void SetQuantum(int level, int ticks);
+    				// Quantum of a level (1-3), or of
+				// all levels (0)
+    void SetAdaptive(bool on) { adaptive = on; }
+
+    int Quantum(Thread *thread);// # of ticks "thread" may run
+
+    void Switched(bool preempted);
+    				// A context switch happened; was it
+				// the end of a quantum?
+    void Tick();		// A timer tick went by
+
+  private:
+    int quantum[4];		// configured quantum of each level
+				// ([0] is unused)
+    bool adaptive;		// adapt to the load?
+    int scale;			// adaptive scaling, as a power of 2
+
+    int numTicks;		// since the last adaptation
+    int numSwitches;		// ditto
+    int numPreempted;		// ditto, ending a quantum
+    int lastTotalTicks;		// stats when we last adapted
+    int lastSystemTicks;
+};
+
+#endif // TIMESLICE_H
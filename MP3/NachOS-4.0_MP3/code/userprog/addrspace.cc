@@ -20,6 +20,7 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "synch.h"
 
 
 //----------------------------------------------------------------------
@@ -77,6 +78,11 @@ AddrSpace::AddrSpace(int *UsedPage, int* freepages)
     }*/
     PhysPagesUsed = UsedPage;
     FreePhysPages = freepages;
+    pageTable = NULL;
+    numPages = 0;
+    threads = new List<UserThread *>;
+    freeStacks = new List<int>;
+    nextThreadId = 1;
     // zero out the entire address space
     //bzero(kernel->machine->mainMemory, MemorySize);
 }
@@ -95,7 +101,12 @@ AddrSpace::~AddrSpace()
         (*FreePhysPages)++;
     }
     // Team42 Add
-    delete pageTable;
+    delete [] pageTable;
+
+    while (!threads->IsEmpty())
+        delete threads->RemoveFront();
+    delete threads;
+    delete freeStacks;
 }
 
 //----------------------------------------------------------------------
@@ -245,6 +256,196 @@ void AddrSpace::Execute(char *fileName)
                         // by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::ForkThread
+// 	Set up "thread" to run the user procedure at "func", in this
+//	address space, on a stack of its own.  Called by a thread running
+//	in this address space (ThreadFork).
+//
+//	Returns the new thread's ThreadId, or -1 if there is no memory
+//	left for its stack.
+//----------------------------------------------------------------------
+
+int AddrSpace::ForkThread(Thread *thread, int func)
+{
+    int sp = AllocateStack();
+
+    if (sp < 0)
+        return -1;
+    RestoreState(); // the page table may have moved
+
+    UserThread *user = new UserThread(thread, nextThreadId++, func, sp);
+
+    threads->Append(user);
+    DEBUG(dbgAddr, "Forking user thread " << user->id << " at " << func
+                   << ", stack " << sp);
+    return user->id;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ExecuteThread
+// 	Run a forked thread, as set up by ForkThread: like Execute, but
+//	starting at the thread's procedure, on its own stack.  If the
+//	procedure returns, it returns to UserThreadReturn, which traps.
+//----------------------------------------------------------------------
+
+void AddrSpace::ExecuteThread(Thread *thread)
+{
+    Machine *machine = kernel->machine;
+    UserThread *user = FindThread(thread);
+
+    ASSERT(user != NULL);
+    InitRegisters();
+    machine->WriteRegister(PCReg, user->func);
+    machine->WriteRegister(NextPCReg, user->func + 4);
+    machine->WriteRegister(StackReg, user->stackTop);
+    machine->WriteRegister(RetAddrReg, UserThreadReturn);
+    RestoreState();
+
+    machine->Run(); // jump to the thread's procedure
+
+    ASSERTNOTREACHED();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ExitThread
+// 	A forked thread is exiting with "exitCode".  Its stack is free
+//	for the next thread; its exit code waits for ThreadJoin.  A thread
+//	that was not forked (the one running main) is not recorded.
+//----------------------------------------------------------------------
+
+void AddrSpace::ExitThread(Thread *thread, int exitCode)
+{
+    UserThread *user = FindThread(thread);
+
+    if (user == NULL)
+        return;
+    DEBUG(dbgAddr, "User thread " << user->id << " exits with " << exitCode);
+    user->done = TRUE;
+    user->exitCode = exitCode;
+    freeStacks->Append(user->stackTop);
+    user->exited->V();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::JoinThread
+// 	Wait for the forked thread "id" to exit, and return its exit
+//	code.  Returns -1 if there is no such thread, or it was joined
+//	already.
+//----------------------------------------------------------------------
+
+int AddrSpace::JoinThread(int id)
+{
+    UserThread *user = FindThread(id);
+    int exitCode;
+
+    if (user == NULL ||
+        (!user->done && user->threadId == kernel->currentThread->getID()))
+        return -1; // a thread cannot join itself
+    if (!user->done)
+        user->exited->P();
+    exitCode = user->exitCode;
+    threads->Remove(user);
+    delete user;
+    return exitCode;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+// 	Find a stack for a new thread: one left by a thread that exited
+//	if there is one, otherwise UserStackSize of new pages at the top
+//	of the address space.  Returns the initial stack pointer, or -1
+//	if there are not enough physical pages left.
+//----------------------------------------------------------------------
+
+int AddrSpace::AllocateStack()
+{
+    unsigned int stackPages = divRoundUp(UserStackSize, PageSize);
+    TranslationEntry *bigger;
+
+    if (!freeStacks->IsEmpty())
+        return freeStacks->RemoveFront();
+    if (stackPages > (unsigned int)(*FreePhysPages))
+        return -1;
+
+    bigger = new TranslationEntry[numPages + stackPages];
+    for (unsigned int i = 0; i < numPages; i++)
+        bigger[i] = pageTable[i];
+    for (unsigned int i = numPages, j = 0; i < numPages + stackPages; i++)
+    {
+        bigger[i].virtualPage = i;
+        while (j < NumPhysPages && PhysPagesUsed[j])
+            j++;
+        (*FreePhysPages)--;
+        bzero(&kernel->machine->mainMemory[j * PageSize], PageSize);
+        PhysPagesUsed[j] = TRUE;
+        bigger[i].physicalPage = j;
+        bigger[i].valid = TRUE;
+        bigger[i].use = FALSE;
+        bigger[i].dirty = FALSE;
+        bigger[i].readOnly = FALSE;
+    }
+    delete [] pageTable;
+    pageTable = bigger;
+    numPages += stackPages;
+
+    // as for the first stack, keep clear of the very end
+    return numPages * PageSize - 16;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindThread
+// 	Return the forked thread run by "thread", or with ThreadId "id";
+//	NULL if there is none.
+//----------------------------------------------------------------------
+
+UserThread *AddrSpace::FindThread(Thread *thread)
+{
+    ListIterator<UserThread *> it(threads);
+
+    for (; !it.IsDone(); it.Next())
+    {
+        if (!it.Item()->done && it.Item()->threadId == thread->getID())
+            return it.Item();
+    }
+    return NULL;
+}
+
+UserThread *AddrSpace::FindThread(int id)
+{
+    ListIterator<UserThread *> it(threads);
+
+    for (; !it.IsDone(); it.Next())
+    {
+        if (it.Item()->id == id)
+            return it.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// UserThread::UserThread
+// 	Record a forked thread, "t", known as "userId" in its address
+//	space, which starts at "start" with stack pointer "sp".
+//----------------------------------------------------------------------
+
+UserThread::UserThread(Thread *t, int userId, int start, int sp)
+{
+    thread = t;
+    threadId = t->getID();
+    id = userId;
+    func = start;
+    stackTop = sp;
+    done = FALSE;
+    exitCode = 0;
+    exited = new Semaphore("user thread exited", 0);
+}
+
+UserThread::~UserThread()
+{
+    delete exited;
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::InitRegisters
 // 	Set the initial values for the user-level register set.
@@ -302,8 +503,13 @@ void AddrSpace::SaveState()
 
 void AddrSpace::RestoreState()
 {
-    kernel->machine->pageTable = pageTable;
-    kernel->machine->pageTableSize = numPages;
+    RestoreState(kernel->machine);
+}
+
+void AddrSpace::RestoreState(Machine *machine)
+{
+    machine->pageTable = pageTable;
+    machine->pageTableSize = numPages;
 }
 
 //----------------------------------------------------------------------
@@ -15,9 +15,38 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "list.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
+// Forked user threads start with this as their return address, so
+// that returning from the thread's procedure traps, and can be taken
+// as ThreadExit(0).
+#define UserThreadReturn	(-4)
+
+class Thread;
+class Semaphore;
+
+// A thread forked inside an address space (by ThreadFork), with its
+// own stack.  Kept until another thread in the address space joins
+// it, to pass on its exit code.
+
+class UserThread {
+  public:
+    UserThread(Thread *t, int userId, int start, int sp);
+    ~UserThread();
+
+    Thread *thread;			// the kernel thread running it
+    int threadId;			// ... and its ID, which is only
+					// its own until it is done
+    int id;				// its ThreadId, in the address space
+    int func;				// where it starts running
+    int stackTop;			// initial stack pointer
+    bool done;				// has it exited?
+    int exitCode;			// ... with what?
+    Semaphore *exited;			// signalled when it is done
+};
+
 class AddrSpace {
   public:
     AddrSpace(int *UsedPage, int* freepages);			// Create an address space.
@@ -34,8 +63,20 @@ class AddrSpace {
 					// assumes the program has already
                                         // been loaded
 
+    int ForkThread(Thread *thread, int func);
+    					// Give "thread" a stack of its
+					// own, to run "func" in this
+					// address space; return its
+					// ThreadId, or -1 if out of memory
+    void ExecuteThread(Thread *thread);	// Run a forked thread
+    void ExitThread(Thread *thread, int exitCode);
+    					// A forked thread is done
+    int JoinThread(int id);		// Wait for a forked thread to
+					// exit; return its exit code
+
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
+    void RestoreState(Machine *machine);// ditto, on a second CPU
 
     // Translate virtual address _vaddr_
     // to physical address _paddr_. _mode_
@@ -48,8 +89,16 @@ class AddrSpace {
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
 
+    List<UserThread *> *threads;	// forked threads not yet joined
+    List<int> *freeStacks;		// stacks of threads that exited
+    int nextThreadId;			// ThreadId of the next fork
+
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
+    int AllocateStack();		// Initial stack pointer of a new
+					// stack, or -1 if out of memory
+    UserThread *FindThread(Thread *thread);
+    UserThread *FindThread(int id);
 
 };
 
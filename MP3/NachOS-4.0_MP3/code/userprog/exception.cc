@@ -186,13 +186,62 @@ void ExceptionHandler(ExceptionType which)
 			DEBUG(dbgAddr, "Program exit\n");
 			val = kernel->machine->ReadRegister(4);
 			cout << "return value:" << val << endl;
+			kernel->currentThread->space->ExitThread(kernel->currentThread, val);
 			kernel->currentThread->Finish();
 			break;
+		case SC_ThreadFork:
+			val = kernel->machine->ReadRegister(4);
+			DEBUG(dbgSys, "ThreadFork " << val << "\n");
+			threadID = SysThreadFork(val);
+			kernel->machine->WriteRegister(2, (int)threadID);
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			return;
+			ASSERTNOTREACHED();
+			break;
+		case SC_ThreadYield:
+			DEBUG(dbgSys, "ThreadYield\n");
+			// advance the PC first: we may not be back for a while
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			SysThreadYield();
+			return;
+			ASSERTNOTREACHED();
+			break;
+		case SC_ThreadExit:
+			val = kernel->machine->ReadRegister(4);
+			DEBUG(dbgSys, "ThreadExit " << val << "\n");
+			SysThreadExit(val);
+			ASSERTNOTREACHED();
+			break;
+		case SC_ThreadJoin:
+			threadID = kernel->machine->ReadRegister(4);
+			DEBUG(dbgSys, "ThreadJoin " << threadID << "\n");
+			status = SysThreadJoin(threadID);
+			kernel->machine->WriteRegister(2, (int)status);
+			kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+			kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+			return;
+			ASSERTNOTREACHED();
+			break;
 		default:
 			cerr << "Unexpected system call " << type << "\n";
 			break;
 		}
 		break;
+	case AddressErrorException:
+		// a forked thread returning from its procedure
+		if (kernel->machine->ReadRegister(BadVAddrReg) == UserThreadReturn)
+		{
+			DEBUG(dbgSys, "User thread returned\n");
+			SysThreadExit(0);
+			ASSERTNOTREACHED();
+		}
+		cerr << "Unexpected user mode exception " << (int)which << "\n";
+		break;
 	default:
 		cerr << "Unexpected user mode exception " << (int)which << "\n";
 		break;
@@ -63,4 +63,25 @@ int SysClose(OpenFileId id)
     return kernel->fileSystem->CloseFile(id);
 }
 
+int SysThreadFork(int func)
+{
+    return kernel->ThreadFork(func);
+}
+
+void SysThreadYield()
+{
+    kernel->currentThread->Yield();
+}
+
+void SysThreadExit(int exitCode)
+{
+    kernel->currentThread->space->ExitThread(kernel->currentThread, exitCode);
+    kernel->currentThread->Finish();
+}
+
+int SysThreadJoin(int id)
+{
+    return kernel->currentThread->space->JoinThread(id);
+}
+
 #endif /* ! __USERPROG_KSYSCALL_H__ */
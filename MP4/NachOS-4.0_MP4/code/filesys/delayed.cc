@@ -0,0 +1,295 @@
+// delayed.cc
+//	Routines to buffer writes to holes in files, and to place them on
+//	disk later, all together.
+//
+//	Placement happens in two steps.  First, inside one journal
+//	transaction, the waiting blocks are sorted by file and by
+//	position in the file, and each run of consecutive blocks gets its
+//	sectors from FileHeader::Fill, starting right behind the sector
+//	before the run (or behind the file header); the file headers and
+//	the free map are written back and the transaction is closed.
+//	Then the data goes out, sorted by sector number.
+//
+//	The lock is held throughout, so a reader never sees a block that
+//	has left the buffer before its data is in the cache.  The journal
+//	transaction is opened before the lock is taken, because the file
+//	system calls Discard from inside its own transactions.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synchdisk.h"
+#include "filehdr.h"
+#include "pbitmap.h"
+#include "journal.h"
+#include "delayed.h"
+
+//----------------------------------------------------------------------
+// CompareBlocks, CompareSectors
+// 	Order waiting blocks by file and position in the file, or by
+//	where they were placed on disk, for qsort.
+//----------------------------------------------------------------------
+
+static int
+CompareBlocks(const void *a, const void *b)
+{
+    DelayedBlock *x = (DelayedBlock *)a, *y = (DelayedBlock *)b;
+
+    if (x->hdrSector != y->hdrSector)
+        return x->hdrSector - y->hdrSector;
+    return x->block - y->block;
+}
+
+static int
+CompareSectors(const void *a, const void *b)
+{
+    return ((DelayedBlock *)a)->sector - ((DelayedBlock *)b)->sector;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::DelayedWrites
+// 	Initialize an empty buffer of waiting blocks.
+//
+//	"freeMap" -- the in-memory free map, to reserve and allocate from
+//	"freeMapFile" -- the file holding the free map on disk
+//	"journal" -- the file system's metadata journal
+//----------------------------------------------------------------------
+
+DelayedWrites::DelayedWrites(PersistentBitmap *freeMap, OpenFile *freeMapFile,
+                             Journal *journal)
+{
+    this->freeMap = freeMap;
+    this->freeMapFile = freeMapFile;
+    this->journal = journal;
+    lock = new Lock("delayed writes lock");
+    blocks = new DelayedBlock[NumDelayedBlocks];
+    numBlocks = 0;
+    numReserved = 0;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::~DelayedWrites
+// 	De-allocate the buffer.  Blocks still waiting are lost, so the
+//	disk must be flushed first.
+//----------------------------------------------------------------------
+
+DelayedWrites::~DelayedWrites()
+{
+    delete lock;
+    delete[] blocks;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Read
+// 	If block "block" of the file whose header is in "hdrSector" is
+//	waiting here, copy it into "into" and return TRUE.
+//----------------------------------------------------------------------
+
+bool DelayedWrites::Read(int hdrSector, int block, char *into)
+{
+    DelayedBlock *b;
+
+    if (numBlocks == 0)
+        return FALSE;
+    lock->Acquire();
+    b = Find(hdrSector, block);
+    if (b != NULL)
+        bcopy(b->data, into, SectorSize);
+    lock->Release();
+    return b != NULL;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Update
+// 	If block "block" of the file whose header is in "hdrSector" is
+//	waiting here, replace its contents with "from" and return TRUE.
+//	It is still written only once, when it is placed.
+//----------------------------------------------------------------------
+
+bool DelayedWrites::Update(int hdrSector, int block, char *from)
+{
+    DelayedBlock *b;
+
+    if (numBlocks == 0)
+        return FALSE;
+    lock->Acquire();
+    b = Find(hdrSector, block);
+    if (b != NULL)
+        bcopy(from, b->data, SectorSize);
+    lock->Release();
+    return b != NULL;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Write
+// 	Hold "from" as the contents of block "block" of the file with
+//	header "hdr", stored in "hdrSector"; the block is a hole.
+//
+//	We reserve enough free sectors for the worst case: the data
+//	sector, plus a new index header at every level of the file.  If
+//	there aren't that many left, return FALSE.  If the buffer is
+//	full, place everything in it first.
+//----------------------------------------------------------------------
+
+bool DelayedWrites::Write(FileHeader *hdr, int hdrSector, int block, char *from)
+{
+    DelayedBlock *b;
+    int cost;
+
+    lock->Acquire();
+    while ((b = Find(hdrSector, block)) == NULL && numBlocks == NumDelayedBlocks)
+    {
+        lock->Release();
+        if (!Place())
+            return FALSE;
+        lock->Acquire();
+    }
+    if (b == NULL)
+    {
+        cost = 1;
+        for (FileOffset size = hdr->LevelSize(); size > SectorSize; size /= NumDirect)
+            cost++;
+        if (freeMap->NumClear() - numReserved < cost)
+        {
+            lock->Release();
+            return FALSE; // the disk is full
+        }
+        b = &blocks[numBlocks++];
+        b->hdrSector = hdrSector;
+        b->block = block;
+        b->reserved = cost;
+        numReserved += cost;
+    }
+    bcopy(from, b->data, SectorSize);
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Discard
+// 	Forget the waiting blocks of the file whose header is in
+//	"hdrSector", and give back their reservations.  Called when the
+//	file is removed, before its header sector can be reused.
+//----------------------------------------------------------------------
+
+void DelayedWrites::Discard(int hdrSector)
+{
+    lock->Acquire();
+    for (int i = numBlocks - 1; i >= 0; i--)
+        if (blocks[i].hdrSector == hdrSector)
+            Drop(i);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Place
+// 	Allocate disk sectors for every waiting block, and write the
+//	blocks to them.
+//
+//	Return FALSE if the allocation fails (only if something took the
+//	reserved space); then nothing is changed and the blocks stay.
+//----------------------------------------------------------------------
+
+bool DelayedWrites::Place()
+{
+    FileHeader *hdr;
+    FileOffset from, to;
+    int first, last, end, goal;
+    bool ok = TRUE;
+
+    if (numBlocks == 0)
+        return TRUE;
+
+    journal->Begin();
+    lock->Acquire();
+    qsort(blocks, numBlocks, sizeof(DelayedBlock), CompareBlocks);
+
+    hdr = new FileHeader;
+    for (first = 0; ok && first < numBlocks; first = last)
+    {
+        int file = blocks[first].hdrSector;
+
+        hdr->FetchFrom(file);
+        for (last = first; last < numBlocks && blocks[last].hdrSector == file;
+             last = end)
+        {
+            // find the run of consecutive blocks starting here
+            for (end = last + 1; end < numBlocks && blocks[end].hdrSector == file &&
+                                 blocks[end].block == blocks[end - 1].block + 1;
+                 end++)
+                ;
+            from = (FileOffset)blocks[last].block * SectorSize;
+            to = (FileOffset)(blocks[end - 1].block + 1) * SectorSize;
+
+            // go right behind the part of the file before the run; if
+            // that is a hole, carry on from the previous run, or start
+            // behind the header
+            goal = (from > 0) ? hdr->ByteToSector(from - 1) : HoleSector;
+            if (goal != HoleSector)
+                freeMap->SetGoal(goal);
+            else if (last == first)
+                freeMap->SetGoal(file);
+            if (hdr->Fill(freeMap, from, to) < 0)
+            {
+                ok = FALSE;
+                break;
+            }
+        }
+        if (!ok)
+            break;
+        hdr->WriteBack(file);
+        for (int i = first; i < last; i++)
+            blocks[i].sector = hdr->ByteToSector((FileOffset)blocks[i].block * SectorSize);
+    }
+    delete hdr;
+
+    if (!ok)
+    {
+        DEBUG(dbgFile, "Out of space placing delayed writes.");
+        freeMap->Revert(freeMapFile);
+        journal->Abort();
+        lock->Release();
+        return FALSE;
+    }
+    freeMap->WriteBack(freeMapFile);
+    journal->End();
+
+    DEBUG(dbgFile, "Placing " << numBlocks << " delayed blocks.");
+    qsort(blocks, numBlocks, sizeof(DelayedBlock), CompareSectors);
+    for (int i = 0; i < numBlocks; i++)
+        kernel->synchDisk->WriteSector(blocks[i].sector, blocks[i].data);
+    numBlocks = 0;
+    numReserved = 0;
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Find
+// 	Return the waiting block "block" of the file whose header is in
+//	"hdrSector", or NULL.
+//----------------------------------------------------------------------
+
+DelayedBlock *DelayedWrites::Find(int hdrSector, int block)
+{
+    for (int i = 0; i < numBlocks; i++)
+        if (blocks[i].hdrSector == hdrSector && blocks[i].block == block)
+            return &blocks[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// DelayedWrites::Drop
+// 	Forget blocks[i] and its reservation; the last block takes its
+//	place.
+//----------------------------------------------------------------------
+
+void DelayedWrites::Drop(int i)
+{
+    numReserved -= blocks[i].reserved;
+    blocks[i] = blocks[--numBlocks];
+}
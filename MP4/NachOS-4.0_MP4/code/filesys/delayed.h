@@ -0,0 +1,103 @@
+// delayed.h
+//	Data structures for delayed allocation of file data.
+//
+//	In write-back mode, the first write to a part of a file that has
+//	no disk sector yet (a hole -- see filehdr.h) does not allocate
+//	one.  The data is kept here instead, and the sectors it will need
+//	(the data sector, and an index header at each level in case none
+//	exists yet) are only reserved: counted against the free space, so
+//	that a write to a full disk still fails right away.
+//
+//	The sectors are chosen when the buffered blocks are flushed -- by
+//	the disk flusher, by Sync, or when the buffer fills up.  By then
+//	we know every block of the file waiting to be written, so they
+//	can be placed in file order, one after another, behind the part
+//	of the file already on disk.  A file built up by many small
+//	appends ends up contiguous, instead of interleaved with whatever
+//	else was allocated between the appends.
+//
+//	Until it is placed, a block is read from here; OpenFile::ReadAt
+//	and WriteAt look here before they look at the file header.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DELAYED_H
+#define DELAYED_H
+
+#include "disk.h"
+#include "synch.h"
+
+class FileHeader;
+class PersistentBitmap;
+class OpenFile;
+class Journal;
+
+// # of blocks that can wait for placement; when they run out, every
+// waiting block is placed at once
+const int NumDelayedBlocks = 256;
+
+// One block of file data that has no disk sector yet.
+
+class DelayedBlock
+{
+public:
+    int hdrSector;         // header of the file it belongs to
+    int block;             // which sector of the file it is
+    int reserved;          // # of free sectors set aside for it
+    int sector;            // where it goes, once placed
+    char data[SectorSize]; // its contents
+};
+
+// The following class defines the buffer of blocks waiting for
+// placement.  It is created by the file system, which hands it the
+// free map and the journal, and hooked into SynchDisk so that a flush
+// places the blocks before writing out the cache.
+
+class DelayedWrites
+{
+public:
+    DelayedWrites(PersistentBitmap *freeMap, OpenFile *freeMapFile,
+                  Journal *journal);
+    // Buffer writes to holes, allocating
+    //  from "freeMap" when they are placed
+    ~DelayedWrites();
+
+    bool Read(int hdrSector, int block, char *into);
+    // Copy out a waiting block; FALSE if
+    //  we don't have it
+    bool Update(int hdrSector, int block, char *from);
+    // Change a waiting block; FALSE if
+    //  we don't have it
+    bool Write(FileHeader *hdr, int hdrSector, int block, char *from);
+    // Hold a write to a hole of the file
+    //  with header "hdr"; FALSE if the
+    //  disk is full
+    void Discard(int hdrSector); // The file is being removed: forget
+                                 //  its blocks and their reservations
+
+    bool Place(); // Allocate sectors for every waiting
+                  //  block and write them; FALSE if the
+                  //  disk filled up anyway
+    bool HasPending() { return numBlocks > 0; }
+    int NumReserved() { return numReserved; } // Free sectors promised
+                                              //  to waiting blocks
+
+private:
+    PersistentBitmap *freeMap; // where sectors come from
+    OpenFile *freeMapFile;     // where the free map is written back
+    Journal *journal;          // makes each placement atomic
+    Lock *lock;                // protects the fields below
+
+    DelayedBlock *blocks; // [0, numBlocks) are waiting
+    int numBlocks;
+    int numReserved;      // sum of their "reserved"
+
+    DelayedBlock *Find(int hdrSector, int block); // lock must be held
+    void Drop(int i);                             // forget blocks[i]
+};
+
+#endif // DELAYED_H
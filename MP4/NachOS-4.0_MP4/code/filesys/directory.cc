@@ -153,6 +153,21 @@ bool Directory::Add(char *name, int newSector, bool AddDir)
     return FALSE; // no space.  Fix when we have extensible files.
 }
 
+//----------------------------------------------------------------------
+// Directory::EntrySector
+// 	Return the header sector of entry "i" of the table, and in
+//	"isDir" whether it is a directory; -1 if the entry is not in use.
+//----------------------------------------------------------------------
+
+int Directory::EntrySector(int i, bool *isDir)
+{
+    ASSERT(i >= 0 && i < tableSize);
+    if (!table[i].inUse)
+        return -1;
+    *isDir = table[i].isDir;
+    return table[i].sector;
+}
+
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return TRUE if successful;
@@ -171,52 +186,6 @@ bool Directory::Remove(char *name)
     return TRUE;
 }
 
-//----------------------------------------------------------------------
-// Directory::RecursiveRemove
-// 	Remove a file name from the directory.  Return TRUE if successful;
-//	return FALSE if the file isn't in the directory.
-//
-//	"name" -- the file name to be removed
-//----------------------------------------------------------------------
-
-void Directory::RecursiveRemove(PersistentBitmap *freeMap)
-{
-    int i;
-    for(int i=0; i<tableSize; i++){
-        if(table[i].inUse){
-            DEBUG(dbgKYL, "table[" << i << "] is " << table[i].name);
-        }
-    }
-    DEBUG(dbgKYL, "END of a dir");
-    for(i=0; i<tableSize; i++){
-        if(table[i].inUse && !table[i].isDir){
-            int sector = table[i].sector;
-            FileHeader* hdr = new FileHeader;
-            hdr->FetchFrom(sector);
-            hdr->Deallocate(freeMap);
-            freeMap->Clear(sector); 
-            Remove(table[i].name);
-        }
-        else if(table[i].inUse && table[i].isDir){
-            int sector = table[i].sector;
-            OpenFile* next_dir_hdr = new OpenFile(sector);
-            Directory* next_level_dir = new Directory(NumDirEntries);
-            next_level_dir->FetchFrom(next_dir_hdr);
-            next_level_dir->RecursiveRemove(freeMap);
-            next_level_dir->WriteBack(next_dir_hdr);
-
-            FileHeader* hdr = new FileHeader;
-            hdr->FetchFrom(sector);
-            hdr->Deallocate(freeMap);
-            freeMap->Clear(sector);
-            Remove(table[i].name);
-            delete next_dir_hdr;
-            delete next_level_dir;
-            delete hdr;
-        }
-    }
-}
-
 //----------------------------------------------------------------------
 // Directory::List
 // 	List all the file names in the directory.
@@ -238,42 +207,6 @@ bool Directory::IsDir(char* name){
     return table[i].isDir;
 }
 
-//----------------------------------------------------------------------
-// Directory::RecursiveList
-// 	List all the file names in the directory recursively.
-//----------------------------------------------------------------------
-
-void Directory::RecursiveList(int num)
-{
-    for (int i = 0; i < tableSize; i++){
-        if (table[i].inUse){
-            if(num != 0){
-                for(int i=0; i<num; i++) printf("%c", '  ');
-                if (table[i].isDir)
-                    printf("%s%s\n", "{D}: ", table[i].name);
-                else
-                    printf("%s%s\n", "{F}: ", table[i].name);
-            }
-            else {
-                if (table[i].isDir)
-                    printf("%s%s\n", "{D}: ", table[i].name);
-                else
-                    printf("%s%s\n", "{F}: ", table[i].name);
-            } 
-        }
-        if(table[i].isDir){
-            int sector = table[i].sector;
-            OpenFile* next_dir_hdr = new OpenFile(sector);
-            Directory* next_dir = new Directory(NumDirEntries);
-            next_dir->FetchFrom(next_dir_hdr);
-            next_dir->RecursiveList(num+1);
-            delete next_dir;
-            delete next_dir_hdr;
-        }
-    }     
-}
-
-
 //----------------------------------------------------------------------
 // Directory::Print
 // 	List all the file names in the directory, their FileHeader locations,
@@ -72,6 +72,10 @@ public:
 
     bool Remove(char *name); // Remove a file from the directory
 
+    int EntrySector(int i, bool *isDir); // Header of entry "i" of the
+                                         //  table, or -1 if unused
+    char *EntryName(int i) { return table[i].name; } // and its name
+
     void List();  // Print the names of all the files
                   //  in the directory
     void Print(); // Verbose print of the contents
@@ -79,10 +83,6 @@ public:
                   //  names and their contents.
     int FindisDir(char* name);
 
-    void RecursiveList(int num);  // Print the names of all the files
-                  //  in the directory recursively
-    void RecursiveRemove(PersistentBitmap *freeMap);
-
     // bool CheckinUse(int num){return table[num].inUse;};
      bool IsDir(char* name);
     // char* Checkname(int num){return table[num].name; };
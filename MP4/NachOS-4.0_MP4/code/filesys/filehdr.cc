@@ -4,11 +4,22 @@
 //
 //	The file header is used to locate where on disk the
 //	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector,
+//	table of pointers.  The table size is chosen so that the file
+//	header will be just big enough to fit in one disk sector.  In a
+//	file of up to NumDirect sectors, each entry in the table points
+//	to the disk sector containing that portion of the file data;
+//	in a bigger file, each entry points to an index header, with a
+//	table of its own, covering a part of the file of LevelSize()
+//	bytes.  There are as many levels of index headers as the file
+//	length (a 64-bit FileOffset) needs.
+//
+//	A file of no more than InlineSize bytes has no table: its
+//	data is kept in the header sector, in the space the table
+//	would take up.
+//
+//	Files are sparse: an entry of the table may be a hole
+//	(HoleSector), with no sector allocated for it until that
+//	part of the file is first written.
 //
 //      Unlike in a real system, we do not keep track of file permissions,
 //	ownership, last modification date, etc., in the file header.
@@ -29,10 +40,6 @@
 #include "synchdisk.h"
 #include "main.h"
 
-#define OneLevelSize (30 * 128)
-#define TwoLevelSize (30 * 30 * 128)
-#define ThreeLevelSize (30 * 30 * 30 * 128)
-
 //----------------------------------------------------------------------
 // MP4 mod tag
 // FileHeader::FileHeader
@@ -44,6 +51,8 @@ FileHeader::FileHeader()
 {
 	numBytes = -1;
 	numSectors = -1;
+	isIndex = FALSE;
+	isInline = FALSE;
 	memset(dataSectors, -1, sizeof(dataSectors));
 }
 
@@ -62,127 +71,95 @@ FileHeader::~FileHeader()
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
-//	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	No disk space is allocated: every entry starts out as a hole,
+//	so creating a file costs the same whatever its size.  Sectors
+//	are allocated by Fill, as the file is written.
 //
-//	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	A file small enough to be inline has no entries at all; its
+//	data starts out as zeroes.
+//
+//	"fileSize" is the number of bytes in the file
 //----------------------------------------------------------------------
 
-bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
+void FileHeader::Allocate(FileOffset fileSize)
 {
 	numBytes = fileSize;
-	numSectors = divRoundUp(fileSize, SectorSize);
-	if (freeMap->NumClear() < numSectors)
-		return FALSE; // not enough space
-
-	
-	if(fileSize > ThreeLevelSize){
-		int i = 0;
-		while(fileSize > 0)
-		{
-			dataSectors[i] = freeMap->FindAndSet();
-			ASSERT(dataSectors[i] >= 0);
+	isInline = !isIndex && fileSize <= (FileOffset)InlineSize;
+	if (isInline)
+	{
+		numSectors = 0;
+		memset(dataSectors, 0, sizeof(dataSectors));
+		return;
+	}
+	numSectors = divRoundUp(fileSize, LevelSize());
+	for (int i = 0; i < NumDirect; i++)
+		dataSectors[i] = HoleSector;
+}
 
-			FileHeader *next_level_hdr = new FileHeader;
+//----------------------------------------------------------------------
+// FileHeader::Fill
+// 	Make sure every sector holding bytes "from" up to (not including)
+//	"to" of the file is allocated, taking a sector out of the map of
+//	free disk blocks for each hole in that range.
+//
+//	A file bigger than NumDirect sectors has a header for each
+//	LevelSize() bytes of it (the last perhaps less); a hole there is
+//	filled with a new index header, itself all holes, and then we
+//	fill the range one level down.  Index headers we change are
+//	written back; this header is left to the caller.
+//
+//	Return the number of sectors allocated, or -1 if the disk filled
+//	up part way (the caller should throw the changes away).
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"from", "to" -- the range of the file to fill
+//----------------------------------------------------------------------
 
-			if (fileSize > ThreeLevelSize)
-			{
-				bool success = next_level_hdr->Allocate(freeMap, ThreeLevelSize);
-				if(!success) return FALSE; // space is not enough
-				fileSize -= ThreeLevelSize;
-			}
-			else
-			{
-				bool success = next_level_hdr->Allocate(freeMap, fileSize);
-				if(!success) return FALSE; // space is not enough
-				fileSize -= fileSize;
-			}
-			next_level_hdr->WriteBack(dataSectors[i]);
-			delete next_level_hdr;
-			i++;
-		}
-		numSectors = i;
-	}
-	else if(fileSize > TwoLevelSize){
-		int i = 0;
-		while(fileSize > 0)
-		{
-			dataSectors[i] = freeMap->FindAndSet();
-			ASSERT(dataSectors[i] >= 0);
+int FileHeader::Fill(PersistentBitmap *freeMap, FileOffset from, FileOffset to)
+{
+	FileOffset level = LevelSize();
+	int count = 0;
 
-			FileHeader *next_level_hdr = new FileHeader;
+	ASSERT(!isInline);
+	for (int i = (int)(from / level); i < numSectors && i * level < to; i++)
+	{
+		bool fresh = (dataSectors[i] == HoleSector);
 
-			if (fileSize > TwoLevelSize)
-			{
-				bool success = next_level_hdr->Allocate(freeMap, TwoLevelSize);
-				if(!success) return FALSE; // space is not enough
-				fileSize -= TwoLevelSize;
-			}
-			else
-			{
-				bool success = next_level_hdr->Allocate(freeMap, fileSize);
-				if(!success) return FALSE; // space is not enough
-				fileSize -= fileSize;
-			}
-			next_level_hdr->WriteBack(dataSectors[i]);
-			delete next_level_hdr;
-			i++;
-		}
-		numSectors = i;
-	}
-	else if(fileSize > OneLevelSize){
-		int i = 0;
-		while(fileSize > 0)
+		if (fresh)
 		{
 			dataSectors[i] = freeMap->FindAndSet();
-			ASSERT(dataSectors[i] >= 0);
-
-			FileHeader *next_level_hdr = new FileHeader;
-
-			if (fileSize > OneLevelSize)
+			if (dataSectors[i] < 0)
 			{
-				bool success = next_level_hdr->Allocate(freeMap, OneLevelSize);
-				if(!success) return FALSE; // space is not enough
-				fileSize -= OneLevelSize;
+				dataSectors[i] = HoleSector;
+				return -1; // disk full
 			}
-			else
-			{
-				bool success = next_level_hdr->Allocate(freeMap, fileSize);
-				if(!success) return FALSE; // space is not enough
-				fileSize -= fileSize;
-			}
-			next_level_hdr->WriteBack(dataSectors[i]);
-			delete next_level_hdr;
-			i++;
-		}
-		numSectors = i;
-
-		// for debug
-		DEBUG(dbgKYL, "Root =========================");
-		for(int i=0; i<numSectors; i++){
 			DEBUG(dbgKYL, "sector num is " << dataSectors[i]);
+			count++;
 		}
-	}
-	else{
-		for (int j = 0; j < numSectors; j++)
-		{
-			dataSectors[j] = freeMap->FindAndSet();
-			// since we checked that there was enough free space,
-			// we expect this to succeed
-			ASSERT(dataSectors[j] >= 0);
-		}
+		if (level == SectorSize)
+			continue;
+
+		FileHeader *next_level_hdr = new FileHeader;
+		FileOffset start = i * level;
+		int n;
 
-		// for debug
-		for(int j=0; j<numSectors; j++){
-			DEBUG(dbgKYL, "sector num is " << dataSectors[j]);
+		if (fresh)
+		{
+			next_level_hdr->isIndex = TRUE;
+			next_level_hdr->Allocate(min(level, numBytes - start));
 		}
-		DEBUG(dbgKYL, "End ===============================");
+		else
+			next_level_hdr->FetchIndexFrom(dataSectors[i]);
+		n = next_level_hdr->Fill(freeMap, max(from - start, (FileOffset)0),
+								 to - start);
+		if (fresh || n != 0)
+			next_level_hdr->WriteBack(dataSectors[i]);
+		delete next_level_hdr;
+		if (n < 0)
+			return -1;
+		count += n;
 	}
-
-	
-	return TRUE;
+	return count;
 }
 
 //----------------------------------------------------------------------
@@ -194,22 +171,21 @@ bool FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 
 void FileHeader::Deallocate(PersistentBitmap *freeMap)
 {
-	if(numBytes > OneLevelSize){
-		for (int i = 0; i < numSectors; i++)
+	FileOffset level = LevelSize();
+
+	for (int i = 0; i < numSectors; i++)
+	{
+		if (dataSectors[i] == HoleSector)
+			continue; // never written
+		if (level > SectorSize)
 		{
 			FileHeader *hdr = new FileHeader;
-			hdr->FetchFrom(dataSectors[i]);
+			hdr->FetchIndexFrom(dataSectors[i]);
 			hdr->Deallocate(freeMap);
-			freeMap->Clear((int)dataSectors[i]);
 			delete hdr;
 		}
-	}
-	else{
-		for (int i = 0; i < numSectors; i++)
-		{
-			ASSERT(freeMap->Test((int)dataSectors[i])); // ought to be marked!
-			freeMap->Clear((int)dataSectors[i]);
-		}
+		ASSERT(freeMap->Test((int)dataSectors[i])); // ought to be marked!
+		freeMap->Clear((int)dataSectors[i]);
 	}
 }
 
@@ -222,12 +198,28 @@ void FileHeader::Deallocate(PersistentBitmap *freeMap)
 
 void FileHeader::FetchFrom(int sector)
 {
-	kernel->synchDisk->ReadSector(sector, (char *)this);
+	char buf[SectorSize];
 
-	/*
-		MP4 Hint:
-		After you add some in-core informations, you will need to rebuild the header's structure
-	*/
+	kernel->synchDisk->ReadSector(sector, buf);
+	bcopy(buf, (char *)&numBytes, sizeof(numBytes));
+	bcopy(buf + sizeof(numBytes), (char *)dataSectors, sizeof(dataSectors));
+	isInline = !isIndex && numBytes <= (FileOffset)InlineSize;
+	numSectors = isInline ? 0 : divRoundUp(numBytes, LevelSize());
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FetchIndexFrom
+// 	Fetch one of the index headers of a file from disk.  Unlike the
+//	top-level header, an index header covering only a few bytes
+//	still holds a sector number, not data.
+//
+//	"sector" is the disk sector containing the header
+//----------------------------------------------------------------------
+
+void FileHeader::FetchIndexFrom(int sector)
+{
+	isIndex = TRUE;
+	FetchFrom(sector);
 }
 
 //----------------------------------------------------------------------
@@ -239,16 +231,11 @@ void FileHeader::FetchFrom(int sector)
 
 void FileHeader::WriteBack(int sector)
 {
-	kernel->synchDisk->WriteSector(sector, (char *)this);
-
-	/*
-		MP4 Hint:
-		After you add some in-core informations, you may not want to write all fields into disk.
-		Use this instead:
-		char buf[SectorSize];
-		memcpy(buf + offset, &dataToBeWritten, sizeof(dataToBeWritten));
-		...
-	*/
+	char buf[SectorSize];
+
+	bcopy((char *)&numBytes, buf, sizeof(numBytes));
+	bcopy((char *)dataSectors, buf + sizeof(numBytes), sizeof(dataSectors));
+	kernel->synchDisk->WriteSector(sector, buf);
 }
 
 //----------------------------------------------------------------------
@@ -258,40 +245,49 @@ void FileHeader::WriteBack(int sector)
 //	offset in the file) to a physical address (the sector where the
 //	data at the offset is stored).
 //
+//	In a big file, each index header on the way is read into a
+//	FileHeader on the stack: OpenFile::ReadAt and WriteAt call this
+//	for every sector they touch, and must not allocate memory.
+//
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
 
-int FileHeader::ByteToSector(int offset)
+int FileHeader::ByteToSector(FileOffset offset)
 {
-	if(numBytes > ThreeLevelSize){
-		FileHeader *hdr = new FileHeader;
-		int sector = divRoundDown(offset, ThreeLevelSize);
-		hdr->FetchFrom(dataSectors[sector]);
-		int value = hdr->ByteToSector(offset - sector * ThreeLevelSize);
-		delete hdr;
-		return value;
-	}
-	else if(numBytes > TwoLevelSize){
-		FileHeader *hdr = new FileHeader;
-		int sector = divRoundDown(offset, TwoLevelSize);
-		hdr->FetchFrom(dataSectors[sector]);
-		int value = hdr->ByteToSector(offset - sector * TwoLevelSize);
-		delete hdr;
-		return value;
-	}
-	else if (numBytes > OneLevelSize)
-	{
-		FileHeader *hdr = new FileHeader;
-		int sector = divRoundDown(offset, OneLevelSize);
-		hdr->FetchFrom(dataSectors[sector]);
-		int value = hdr->ByteToSector(offset - sector * OneLevelSize);
-		delete hdr;
-		return value;
-	}
-	else
-	{
-		return (dataSectors[offset / SectorSize]);
-	}
+	FileOffset level = LevelSize();
+	int i = (int)(offset / level);
+
+	ASSERT(!isInline); // there is no sector to return
+	if (level == SectorSize || dataSectors[i] == HoleSector)
+		return (dataSectors[i]);
+
+	FileHeader index;
+	index.FetchIndexFrom(dataSectors[i]);
+	return index.ByteToSector(offset - i * level);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ReadInline/WriteInline
+// 	Copy part of the data of an inline file out of, or into, the
+//	header.  Writing only changes the copy in memory; the caller
+//	writes the header back.
+//
+//	"into" -- the buffer to hold the data read
+//	"from" -- the data to be written
+//	"count" -- the number of bytes to copy
+//	"position" -- the offset within the file of the first byte
+//----------------------------------------------------------------------
+
+void FileHeader::ReadInline(char *into, int count, int position)
+{
+	ASSERT(isInline && position >= 0 && position + count <= numBytes);
+	bcopy((char *)dataSectors + position, into, count);
+}
+
+void FileHeader::WriteInline(char *from, int count, int position)
+{
+	ASSERT(isInline && position >= 0 && position + count <= numBytes);
+	bcopy(from, (char *)dataSectors + position, count);
 }
 
 //----------------------------------------------------------------------
@@ -299,11 +295,28 @@ int FileHeader::ByteToSector(int offset)
 // 	Return the number of bytes in the file.
 //----------------------------------------------------------------------
 
-int FileHeader::FileLength()
+FileOffset FileHeader::FileLength()
 {
 	return numBytes;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::LevelSize
+// 	Return how many bytes of the file each entry of dataSectors
+//	stands for.  For a small file that is one sector of data; each
+//	level of index headers above that multiplies it by NumDirect.
+//	A file gets just enough levels for NumDirect entries to cover it.
+//----------------------------------------------------------------------
+
+FileOffset FileHeader::LevelSize()
+{
+	FileOffset level = SectorSize;
+
+	while (numBytes > 0 && (numBytes - 1) / level >= (FileOffset)NumDirect)
+		level *= NumDirect;
+	return level;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -315,13 +328,31 @@ void FileHeader::Print()
 	int i, j, k;
 	char *data = new char[SectorSize];
 
-	printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
+	if (isInline)
+	{
+		printf("FileHeader contents.  File size: %lld.  Inline data:\n", numBytes);
+		for (j = 0; j < numBytes; j++)
+		{
+			char c = ((char *)dataSectors)[j];
+			if ('\040' <= c && c <= '\176') // isprint(c)
+				printf("%c", c);
+			else
+				printf("\\%x", (unsigned char)c);
+		}
+		printf("\n");
+		delete[] data;
+		return;
+	}
+
+	printf("FileHeader contents.  File size: %lld.  File blocks:\n", numBytes);
 
-	if (numBytes > OneLevelSize){
+	if (LevelSize() > SectorSize){
 		for (i = 0; i < numSectors; i++)
 		{
+			if (dataSectors[i] == HoleSector)
+				continue; // nothing written there yet
 			FileHeader *hdr = new FileHeader;
-			hdr->FetchFrom(dataSectors[i]);
+			hdr->FetchIndexFrom(dataSectors[i]);
 			hdr->Print();
 		}
 	}
@@ -331,7 +362,10 @@ void FileHeader::Print()
 		printf("\nFile contents:\n");
 		for (i = k = 0; i < numSectors; i++)
 		{
-			kernel->synchDisk->ReadSector(dataSectors[i], data);
+			if (dataSectors[i] == HoleSector)
+				memset(data, 0, SectorSize); // a hole reads as zeroes
+			else
+				kernel->synchDisk->ReadSector(dataSectors[i], data);
 			for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++)
 			{
 				if ('\040' <= data[j] && data[j] <= '\176') // isprint(data[j])
@@ -347,12 +381,14 @@ void FileHeader::Print()
 
 void FileHeader::PrintUse(){
 	int i;
-	if (numBytes > OneLevelSize){
+	if (LevelSize() > SectorSize){
 		for (i = 0; i < numSectors; i++)
 		{
+			if (dataSectors[i] == HoleSector)
+				continue;
 			printf("%d ", dataSectors[i]);
 			FileHeader *hdr = new FileHeader;
-			hdr->FetchFrom(dataSectors[i]);
+			hdr->FetchIndexFrom(dataSectors[i]);
 			hdr->PrintUse();
 		}
 	}
@@ -17,12 +17,20 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect ((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize (NumDirect * SectorSize)
+#define NumDirect ((int)((SectorSize - sizeof(FileOffset)) / sizeof(int)))
 
-#define OneLevelSize (30 * 128)
-#define TwoLevelSize (30 * 30 * 128)
-#define ThreeLevelSize (30 * 30 * 30 * 128)
+// A file this small keeps its data in the header sector itself, in
+// place of the table of sectors: it costs one sector rather than two,
+// and one disk read rather than two.  Only the top-level header of a
+// file is ever "inline"; the index headers of a bigger file always
+// hold sector numbers, however few bytes the last one covers.
+#define InlineSize (NumDirect * sizeof(int))
+
+// An entry of the table with no sector behind it yet: a "hole".  Files
+// are created with nothing but holes; a sector (and, in a big file,
+// the index headers leading to it) is allocated the first time
+// something is written there.  Holes read as zeroes.
+#define HoleSector (-1)
 
 // The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
@@ -32,8 +40,13 @@
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.  A file too big for NumDirect data sectors
+// gets a tree of headers instead: each entry of the table is then
+// the header of a subtree covering LevelSize() bytes of the file.
+// The tree has as many levels as the file needs.
+//
+// A file of at most InlineSize bytes has no data sectors at all;
+// its contents are stored where the table would be (see IsInline).
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -46,22 +59,38 @@ public:
 	FileHeader(); // dummy constructor to keep valgrind happy
 	~FileHeader();
 
-	bool Allocate(PersistentBitmap *bitMap, int fileSize); // Initialize a file header,
-														   //  including allocating space
-														   //  on disk for the file data
+	void Allocate(FileOffset fileSize);			   // Initialize a file header
+														   //  for a file of all holes
+	int Fill(PersistentBitmap *freeMap, FileOffset from, FileOffset to);
+														   // Allocate sectors for the
+														   //  holes in a range of the file
 	void Deallocate(PersistentBitmap *bitMap);			   // De-allocate this file's
 														   //  data blocks
 
 	void FetchFrom(int sectorNumber); // Initialize file header from disk
+	void FetchIndexFrom(int sectorNumber); // Same, for an index header
+										   //  (never inline)
 	void WriteBack(int sectorNumber); // Write modifications to file header
 									  //  back to disk
 
-	int ByteToSector(int offset); // Convert a byte offset into the file
+	int ByteToSector(FileOffset offset); // Convert a byte offset into the file
 								  // to the disk sector containing
-								  // the byte
+								  // the byte (HoleSector if none)
+
+	FileOffset FileLength(); // Return the length of the file
+							 // in bytes
+
+	bool IsInline() { return isInline; } // Is the data in the header?
+	void ReadInline(char *into, int count, int position);
+	void WriteInline(char *from, int count, int position);
+	// Copy bytes of an inline file's
+	//  data out of/into the header
 
-	int FileLength(); // Return the length of the file
-					  // in bytes
+	int NumSectors() { return numSectors; } // # of entries in use
+	int DataSector(int i) { return dataSectors[i]; } // Sector of entry "i"
+	FileOffset LevelSize(); // # of file bytes each entry covers;
+					 // more than SectorSize means the
+					 // entries are index headers
 
 	void Print(); // Print the contents of the file.
 
@@ -77,16 +106,21 @@ private:
 		In order to implement a data structure, you will need to add some "in-core" data
 		to maintain data structure.
 		
-		Disk Part - numBytes, numSectors, dataSectors occupy exactly 128 bytes and will be
+		Disk Part - numBytes, dataSectors occupy exactly 128 bytes and will be
 		written to a sector on disk.
-		In-core part - none
+		In-core part - numSectors, which follows from numBytes, and
+		isIndex/isInline, which follow from how the header was reached
 		
 	*/
 
-	int numBytes;				// Number of bytes in the file
-	int numSectors;				// Number of data sectors in the file
+	FileOffset numBytes;		// Number of bytes in the file
 	int dataSectors[NumDirect]; // Disk sector numbers for each data
 								// block in the file
+	int numSectors;				// Number of entries of dataSectors
+								// in use
+	bool isIndex;				// Is this an index header of a
+								// bigger file?
+	bool isInline;				// Does dataSectors hold the data?
 };
 
 #endif // FILEHDR_H
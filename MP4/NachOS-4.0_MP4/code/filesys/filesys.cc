@@ -15,29 +15,42 @@
 //
 //      Both the bitmap and the directory are represented as normal
 //	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them
-//	on bootup.
+//	(sector 1 and sector 2), so that the file system can find them
+//	on bootup.  Sector 0 holds the superblock, which says how big
+//	the file system is.
 //
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
+//	The bitmap is also kept in memory for as long as the file system
+//	is mounted; only the sectors of the bitmap file that an operation
+//	actually changed are written back (cf. pbitmap.h).
+//
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are committed to the metadata journal as one transaction (cf.
+//	journal.h), so they reach the disk all together or not at all.
+//	If the operation fails, and we have modified part of the
+//	directory and/or bitmap, we simply discard the changed version,
+//	without writing it back to disk (for the in-memory bitmap, by
+//	re-reading the sectors we touched).
+//
+//	Operations that change the metadata are serialized: only one
+//	thread at a time may have a journal transaction open.  Reads and
+//	writes of file data are synchronized per file, by locking the
+//	byte ranges they touch (cf. rangelock.h), so they need not wait
+//	for each other unless they overlap.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
+//	   a file is limited only by the size of the disk (a big one
+//	     gets a tree of index headers, cf. filehdr.h, and offsets
+//	     are 64 bits)
 //	   there is no hierarchical directory structure, and only a limited
 //	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   file data is not journaled; a crash in the middle of a
+//	    Write may leave part of the old and part of the new contents
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -51,20 +64,14 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
-
-// Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known
-// sectors, so that they can be located on boot-up.
-#define FreeMapSector 0
-#define DirectorySector 1
-
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize (NumSectors / BitsInByte)
-// MP4 part3-2
-#define NumDirEntries 64 // to support 64 files
-#define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
+#include "fslayout.h"
+#include "journal.h"
+#include "delayed.h"
+#include "reaper.h"
+#include "treewalk.h"
+#include "fsck.h"
+#include "synchdisk.h"
+#include "main.h"
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -73,34 +80,55 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to check the superblock, and open
+//	the files representing the bitmap and the directory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format)
 {
+    int numSectors = kernel->synchDisk->NumSectors();
+    char *buf = new char[SectorSize];
+    SuperBlock *super = (SuperBlock *)buf;
+
     DEBUG(dbgFile, "Initializing the file system.");
     if (format)
     {
-        PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
+        freeMap = new PersistentBitmap(numSectors);
         Directory *directory = new Directory(NumDirEntries);
         FileHeader *mapHdr = new FileHeader;
         FileHeader *dirHdr = new FileHeader;
 
         DEBUG(dbgFile, "Formatting the file system.");
 
-        // First, allocate space for FileHeaders for the directory and bitmap
+        // First, record the size of the file system, and allocate space
+        // for FileHeaders for the directory and bitmap
         // (make sure no one else grabs these!)
+        memset(buf, 0, SectorSize);
+        super->magic = SuperMagic;
+        super->sectorSize = SectorSize;
+        super->sectorsPerTrack = SectorsPerTrack;
+        super->numSectors = numSectors;
+        super->sectorsPerGroup = sectorsPerGroup = SectorsPerGroup;
+        super->numGroups = numGroups = divRoundUp(numSectors, SectorsPerGroup);
+        kernel->synchDisk->WriteSector(SuperSector, buf);
+
+        freeMap->Mark(SuperSector);
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
+        for (int i = JournalSector; i <= JournalSector + JournalSize; i++)
+            freeMap->Mark(i);
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
 
-        ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-        ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+        // (These two files are never sparse: the free map can't need
+        // to allocate space to record an allocation.)
+        mapHdr->Allocate(FreeMapFileSize(numSectors));
+        ASSERT(mapHdr->Fill(freeMap, 0, FreeMapFileSize(numSectors)) >= 0);
+        dirHdr->Allocate(DirectoryFileSize);
+        ASSERT(dirHdr->Fill(freeMap, 0, DirectoryFileSize) >= 0);
 
         // Flush the bitmap and directory FileHeaders back to disk
         // We need to do this before we can "Open" the file, since open
@@ -128,6 +156,11 @@ FileSystem::FileSystem(bool format)
         freeMap->WriteBack(freeMapFile); // flush changes to disk
         directory->WriteBack(directoryFile);
 
+        // Finally, lay down an empty log.  Everything from here on
+        // is journaled.
+        journal = new Journal(JournalSector, JournalSize);
+        journal->Format();
+
         if (debug->IsEnabled('f'))
         {
             freeMap->Print();
@@ -136,18 +169,53 @@ FileSystem::FileSystem(bool format)
 
         activeFile = NULL;
 
-        delete freeMap;
         delete directory;
         delete mapHdr;
         delete dirHdr;
     }
     else
     {
-        // if we are not formatting the disk, just open the files representing
-        // the bitmap and directory; these are left open while Nachos is running
+        // if we are not formatting the disk, first make sure it holds a
+        // file system we understand, then bring it up to date by replaying
+        // the journal, then just open the files representing the bitmap
+        // and directory; these are left open while Nachos is running
+        kernel->synchDisk->ReadSector(SuperSector, buf);
+        if (super->magic != SuperMagic || super->sectorSize != SectorSize)
+            cerr << "The disk was not formatted by this version of Nachos; "
+                 << "format it with -f.\n";
+        ASSERT(super->magic == SuperMagic && super->sectorSize == SectorSize);
+        ASSERT(super->numSectors == numSectors);
+        sectorsPerGroup = super->sectorsPerGroup;
+        numGroups = super->numGroups;
+        if (sectorsPerGroup <= 0) // formatted before there were groups
+        {
+            sectorsPerGroup = SectorsPerGroup;
+            numGroups = divRoundUp(numSectors, SectorsPerGroup);
+        }
+
+        journal = new Journal(JournalSector, JournalSize);
+        journal->Recover();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+
+        // the bitmap stays in memory too, so we only read it once
+        freeMap = new PersistentBitmap(freeMapFile, numSectors);
     }
+    delete[] buf;
+    // in write-back mode, transactions are committed in groups
+    // by the disk flusher
+    journal->SetGroupCommit(kernel->synchDisk->IsWriteBack());
+    kernel->synchDisk->SetJournal(journal);
+
+    // in write-back mode, data sectors are chosen when the data is
+    // flushed, not when it is written
+    delayed = NULL;
+    if (kernel->synchDisk->IsWriteBack())
+        delayed = new DelayedWrites(freeMap, freeMapFile, journal);
+    kernel->synchDisk->SetDelayed(delayed);
+
+    // removed files are freed in the background
+    reaper = new Reaper(freeMap, freeMapFile, journal);
 }
 
 //----------------------------------------------------------------------
@@ -156,8 +224,16 @@ FileSystem::FileSystem(bool format)
 //----------------------------------------------------------------------
 FileSystem::~FileSystem()
 {
+    ASSERT(!freeMap->IsDirty()); // every operation flushes its changes
+    delete reaper; // its queues are empty by now
+    kernel->synchDisk->SetDelayed(NULL);
+    delete delayed;
+    delete freeMap;
     delete freeMapFile;
     delete directoryFile;
+    kernel->synchDisk->SetJournal(NULL);
+    delete journal; // anything not yet checkpointed is
+                    // replayed at the next mount
 }
 
 //----------------------------------------------------------------------
@@ -169,7 +245,9 @@ FileSystem::~FileSystem()
 //	The steps to create a file are:
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
-// 	  Allocate space on disk for the data blocks for the file
+// 	  Set up the header for a file that is all holes (data blocks
+//	    are allocated as the file is written, or as it is flushed
+//	    in write-back mode -- cf. FileSystem::Fill, delayed.h)
 //	  Add the name to the directory
 //	  Store the new file header on disk
 //	  Flush the changes to the bitmap and the directory back to disk
@@ -180,7 +258,6 @@ FileSystem::~FileSystem()
 //   		file is already in directory
 //	 	no free space for file header
 //	 	no free entry for file in directory
-//	 	no free space for data blocks for the file
 //
 // 	Note that this implementation assumes there is no concurrent access
 //	to the file system!
@@ -189,13 +266,13 @@ FileSystem::~FileSystem()
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
-bool FileSystem::Create(char *name, int initialSize)
+bool FileSystem::Create(char *name, FileOffset initialSize)
 {
     Directory *directory;
-    PersistentBitmap *freeMap;
     FileHeader *hdr;
     OpenFile* recur = directoryFile;
     int sector;
+    int parent = DirectorySector; // header of the directory we add to
     int free_sector;
     bool success;
     char sep[2] = "/";
@@ -203,6 +280,7 @@ bool FileSystem::Create(char *name, int initialSize)
 
     DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
 
+    journal->Begin();
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
 
@@ -218,13 +296,19 @@ bool FileSystem::Create(char *name, int initialSize)
         }
         DEBUG(dbgKYL, "Enter will be wrong!");
         sector = directory->Find(token); // find the next level dir in current dir 
+        parent = sector;
         recur = new OpenFile(sector); // use open file open the next dir
         directory->FetchFrom(recur); // change directory to the next level directory
         token = strtok(NULL, sep); // keep doing strtok to parse
     }
 
-    freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-    free_sector = freeMap->FindAndSet(); // find a sector to hold the file header
+    if (delayed != NULL && freeMap->NumClear() <= delayed->NumReserved())
+        free_sector = -1; // the rest is promised to delayed writes
+    else
+    {
+        freeMap->SetGoal(parent); // keep the file near its directory
+        free_sector = freeMap->FindAndSet(); // find a sector to hold the file header
+    }
     if (free_sector == -1)
         success = FALSE; // no free block for file header
     else if (!directory->Add(token, free_sector, FALSE))
@@ -232,27 +316,74 @@ bool FileSystem::Create(char *name, int initialSize)
     else
     {
         hdr = new FileHeader;
-        if (!hdr->Allocate(freeMap, initialSize))
-            success = FALSE; // no space on disk for data
-        else
-        {
-            success = TRUE;
-            // everthing worked, flush all changes back to disk
-            hdr->WriteBack(free_sector);
-            DEBUG(dbgKYL, "Before writeback");
-            directory->WriteBack(recur);
-            DEBUG(dbgKYL, "After writeback");
-            freeMap->WriteBack(freeMapFile);
-        }
+        hdr->Allocate(initialSize); // all holes, until written
+        success = TRUE;
+        // everthing worked, flush all changes back to disk
+        hdr->WriteBack(free_sector);
+        DEBUG(dbgKYL, "Before writeback");
+        directory->WriteBack(recur);
+        DEBUG(dbgKYL, "After writeback");
+        freeMap->WriteBack(freeMapFile);
         delete hdr;
     }
-    
-    delete freeMap;
+    if (success)
+        journal->End();
+    else
+    {
+        // revert while our transaction still keeps other threads
+        // away from the free map
+        freeMap->Revert(freeMapFile); // give back anything we grabbed
+        journal->Abort();
+    }
+
     delete directory;
     //delete recur;  // may not delete !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::Fill
+// 	Allocate disk sectors for the holes in bytes "from" up to "to"
+//	of the open file with header "hdr", stored in sector "hdrSector".
+//	Called by OpenFile::WriteAt the first time part of a file is
+//	written, unless the disk is in write-back mode (then the data
+//	waits for DelayedWrites::Place).  The new sectors are taken from
+//	just after the part of the file before them (or the file header),
+//	and the header, any index headers and the free map are all
+//	updated in one journal transaction.
+//
+//	We re-read the header first, in case the holes were filled
+//	through another OpenFile.
+//
+//	Return FALSE if the disk is full; then nothing is changed.
+//----------------------------------------------------------------------
+
+bool FileSystem::Fill(FileHeader *hdr, int hdrSector, FileOffset from,
+                      FileOffset to)
+{
+    int count, goal;
+
+    journal->Begin();
+    hdr->FetchFrom(hdrSector);
+    goal = (from > 0) ? hdr->ByteToSector(from - 1) : HoleSector;
+    freeMap->SetGoal(goal != HoleSector ? goal : hdrSector);
+    count = hdr->Fill(freeMap, from, to);
+    if (count < 0)
+    {
+        freeMap->Revert(freeMapFile);
+        journal->Abort();
+        hdr->FetchFrom(hdrSector); // forget the sectors we took
+        return FALSE;
+    }
+    if (count > 0)
+    {
+        hdr->WriteBack(hdrSector);
+        freeMap->WriteBack(freeMapFile);
+    }
+    journal->End();
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.
@@ -312,17 +443,24 @@ int FileSystem::CloseFile(){
 //----------------------------------------------------------------------
 // FileSystem::CreateDirectory
 // 	Create a directory 
+//
+//	Return FALSE, changing nothing, if there is no room for it in its
+//	parent, or not enough free sectors for its header and contents
+//	besides those promised to delayed writes (as for Create).
 //----------------------------------------------------------------------
 
-void FileSystem::CreateDirectory(char* name){
+bool FileSystem::CreateDirectory(char* name){
     Directory *directory;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
     char sep[2] = "/";
     char* token;
     int sector;
+    int parent = DirectorySector; // header of the directory we add to
     int free_sector;
+    bool success;
     OpenFile* recur = directoryFile; // get the file header of directory
 
+    journal->Begin();
+
     // get the root directory
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
@@ -338,26 +476,28 @@ void FileSystem::CreateDirectory(char* name){
         }
 
         sector = directory->Find(token); // find the next level dir in current dir 
+        parent = sector;
         recur = new OpenFile(sector); // use open file open the next dir
         directory->FetchFrom(recur); // change directory to the next level directory
         token = strtok(NULL, sep); // keep doing strtok to parse
     }
 
+    freeMap->SetGoal(DirectoryGoal(parent));
     free_sector = freeMap->FindAndSet(); // find a sector to hold the file header
-    ASSERT(free_sector >= 0); // ensure we have find free sector
-
-
-    if(!directory->Add(token, free_sector, TRUE)) { // add a sector for new dir in current directory structure
-        ASSERT(FALSE); // no space in directory
-    }
 
     FileHeader* hdr = new FileHeader; 
-    if (!hdr->Allocate(freeMap, DirectoryFileSize)) { // new dir's file header allocate the space for new dir
-        ASSERT(FALSE);
-    }
+    hdr->Allocate(DirectoryFileSize);
+    if (free_sector == -1)
+        success = FALSE; // no free block for file header
+    else if (!directory->Add(token, free_sector, TRUE)) // add a sector for new dir in current directory structure
+        success = FALSE; // no space in directory
+    else if (hdr->Fill(freeMap, 0, DirectoryFileSize) < 0) // new dir's file header allocate the space for new dir
+        success = FALSE;
+    else if (delayed != NULL && freeMap->NumClear() < delayed->NumReserved())
+        success = FALSE; // we took sectors promised to delayed writes
     else { 
         // everthing worked, flush all changes back to disk
-
+        success = TRUE;
         hdr->WriteBack(free_sector); // write new dir's file header sector back
         OpenFile* newDirhdr = new OpenFile(free_sector); 
         Directory* newDir = new Directory(NumDirEntries); // use new dir's open file to open the new dir directory class
@@ -367,21 +507,61 @@ void FileSystem::CreateDirectory(char* name){
         delete newDirhdr;
         delete newDir;
     }
+    if (success)
+        journal->End();
+    else
+    {
+        freeMap->Revert(freeMapFile); // give back anything we grabbed
+        journal->Abort();
+    }
     delete hdr;
     //delete recur;  // may not delete !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
     delete directory;
-    delete freeMap;
-    
+    return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::DirectoryGoal
+// 	Decide where on disk a new subdirectory of the directory whose
+//	header is at "parentSector" should go.  We keep it in its
+//	parent's block group, so that a whole subtree is read with short
+//	seeks, unless that group has less free space than the average;
+//	then we move on to the next group that has more, so that one
+//	group doesn't fill up and push its directories' files out into
+//	groups far away.
+//
+//	Returns the sector to start allocating from.
+//----------------------------------------------------------------------
+
+int FileSystem::DirectoryGoal(int parentSector)
+{
+    int numSectors = kernel->synchDisk->NumSectors();
+    int average = freeMap->NumClear() / numGroups;
+    int first = parentSector / sectorsPerGroup;
+
+    for (int i = 0; i < numGroups; i++)
+    {
+        int group = (first + i) % numGroups;
+        int start = group * sectorsPerGroup;
+        int count = min(sectorsPerGroup, numSectors - start);
+
+        if (freeMap->NumClear(start, count) >= average)
+        {
+            DEBUG(dbgFile, "New directory goes in group " << group);
+            return (group == first) ? parentSector : start;
+        }
+    }
+    return parentSector;
+}
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
-// 	Delete a file from the file system.  This requires:
+// 	Delete a file from the file system.  As in UNIX, this only
+//	removes its name:
 //	    Remove it from the directory
-//	    Delete the space for its header
-//	    Delete the space for its data blocks
-//	    Write changes to directory, bitmap back to disk
+//	    Write the directory back to disk
+//	The space for its header and data blocks is freed later by the
+//	reaper thread, once no OpenFile for it is left (see reaper.h).
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
 //	in the file system.
@@ -392,13 +572,12 @@ void FileSystem::CreateDirectory(char* name){
 bool FileSystem::Remove(char *name)
 {
     Directory *directory;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-    FileHeader *fileHdr;
     OpenFile* recur; // get the file header of directory
     int sector;
     char sep[2] = "/";
     char* token;
 
+    journal->Begin();
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
 
@@ -422,20 +601,14 @@ bool FileSystem::Remove(char *name)
     if (sector == -1)
     {
         delete directory;
+        journal->End(); // nothing to commit
         return FALSE; // file not found
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    fileHdr->Deallocate(freeMap); // remove data blocks
-    freeMap->Clear(sector);       // remove header block
     directory->Remove(token);
-
-    freeMap->WriteBack(freeMapFile);     // flush to disk
     directory->WriteBack(recur); // flush to disk
-    delete fileHdr;
+    journal->End();
+    reaper->Unlinked(sector, FALSE); // free it once it is closed
     delete directory;
-    delete freeMap;
     //delete recur;
     return TRUE;
 }
@@ -444,9 +617,9 @@ bool FileSystem::Remove(char *name)
 // FileSystem::RecursiveRemove
 // 	Delete a file from the file system recursively.  This requires:
 //	    Remove it from the directory
-//	    Delete the space for its header
-//	    Delete the space for its data blocks
-//	    Write changes to directory, bitmap back to disk
+//	    Write the directory back to disk
+//	The reaper thread then frees the space of the whole tree under
+//	it, in the background.
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
 //	in the file system.
@@ -456,7 +629,6 @@ bool FileSystem::Remove(char *name)
 void FileSystem::RecursiveRemove(char* name)
 {
     Directory *directory, *next_level_dir;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
     OpenFile* recur = directoryFile; // get the file header of directory
     int sector;
     char sep[2] = "/";
@@ -466,6 +638,7 @@ void FileSystem::RecursiveRemove(char* name)
     char duplicate[256];
     strcpy(duplicate, name);
 
+    journal->Begin();
     directory = new Directory(NumDirEntries);
     next_level_dir = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
@@ -537,24 +710,14 @@ void FileSystem::RecursiveRemove(char* name)
         //     directory->FetchFrom(recur); // change directory to the next level directory
             
         // }
-        OpenFile *next_level_hdr = new OpenFile(sector);
-        next_level_dir->FetchFrom(next_level_hdr);
-        next_level_dir->RecursiveRemove(freeMap);
-        next_level_dir->WriteBack(next_level_hdr);
-        // 
-        FileHeader* hdr = new FileHeader;
-        hdr->FetchFrom(sector);
-        hdr->Deallocate(freeMap);
-        freeMap->Clear(sector);
+        // unlink the tree; the reaper takes it apart
         directory->Remove(prev_token);
         directory->WriteBack(recur);
-        freeMap->WriteBack(freeMapFile);
-        delete next_level_hdr;
-        delete hdr;
+        reaper->Unlinked(sector, TRUE);
     }
+    journal->End();
     delete directory;
     delete next_level_dir;
-    delete freeMap;
 }
 
 //----------------------------------------------------------------------
@@ -592,14 +755,17 @@ void FileSystem::List(char* name)
 //----------------------------------------------------------------------
 // FileSystem::RecursiveList
 // 	List all the files and directory in the assigned directory recursively.
+//	The tree is read a level at a time, in sector order (see
+//	treewalk.h), and printed once it is all in memory.
 //----------------------------------------------------------------------
 void FileSystem::RecursiveList(char* name){
     Directory *directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
     OpenFile* recur; // get the file header of directory
-    int sector;
+    int sector = DirectorySector;
     char sep[2] = "/";
     char* token;
+    TreeWalk *walk;
 
       /* get the first token */
     token = strtok(name, sep);
@@ -611,12 +777,97 @@ void FileSystem::RecursiveList(char* name){
         ASSERT(sector >= 0);
         recur = new OpenFile(sector); // use open file open the next dir
         directory->FetchFrom(recur); // change directory to the next level directory
+        delete recur;
         token = strtok(NULL, sep); // keep doing strtok to parse
     }
-
-    directory->RecursiveList(0);
-    delete recur;
     delete directory;
+
+    // read the rest of the tree a level at a time, then print it
+    walk = new TreeWalk(sector);
+    walk->Run();
+    walk->List();
+    delete walk;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::BeginBatch/EndBatch
+// 	Bracket a group of Create/CreateDirectory calls, so that their
+//	metadata goes to the journal as one commit instead of one per
+//	operation.  A single operation in the batch that fails is still
+//	undone on its own.
+//
+//	File data must not be written inside a batch -- the journal would
+//	capture it too.
+//----------------------------------------------------------------------
+
+void FileSystem::BeginBatch()
+{
+    journal->Begin();
+}
+
+void FileSystem::EndBatch()
+{
+    journal->End();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Closed/Reap
+// 	Closed is called when the last OpenFile of a removed file is
+//	deleted: its space can be freed now.  Reap frees the space of
+//	every removed file without waiting for the reaper thread (for
+//	Sync and Halt).
+//----------------------------------------------------------------------
+
+void FileSystem::Closed(int sector)
+{
+    reaper->Closed(sector);
+}
+
+void FileSystem::Reap()
+{
+    reaper->Drain();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Check
+// 	Check that the directories, the file headers and the free map
+//	agree with each other (see fsck.h), and print what was found.
+//
+//	If "repair", also fix what can be fixed, as one journal
+//	transaction: directory entries naming broken headers are removed,
+//	and then the free map is made to match what is really in use.
+//	Return TRUE if the file system is (now) consistent.
+//
+//	Nothing else may be using the file system while this runs.
+//	Removed files the reaper has not freed yet would look leaked, so
+//	we free them first.
+//----------------------------------------------------------------------
+
+bool FileSystem::Check(bool repair)
+{
+    FileSystemCheck *check;
+    int problems;
+
+    reaper->Drain();
+    check = new FileSystemCheck(freeMap, journal->IsEnabled());
+    problems = check->Scan();
+
+    check->Report();
+    if (repair && problems > 0)
+    {
+        journal->Begin();
+        if (check->RemoveBadEntries() > 0)
+            check->Scan(); // what they used is leaked now
+        if (check->FixFreeMap() > 0)
+            freeMap->WriteBack(freeMapFile);
+        journal->End();
+
+        printf("fsck: after repair\n");
+        problems = check->Scan();
+        check->Report();
+    }
+    delete check;
+    return problems == 0;
 }
 
 //----------------------------------------------------------------------
@@ -633,7 +884,6 @@ void FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
     Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
@@ -651,7 +901,6 @@ void FileSystem::Print()
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
     delete directory;
 }
 
@@ -39,6 +39,11 @@
 
 typedef int OpenFileId;
 
+class PersistentBitmap;
+class Journal;
+class DelayedWrites;
+class Reaper;
+
 #ifdef FILESYS_STUB // Temporarily implement file system calls as
 // calls to UNIX, until the real file system
 // implementation is available
@@ -88,13 +93,21 @@ public:
 	// MP4 mod tag
 	~FileSystem();
 
-	bool Create(char *name, int initialSize);
+	bool Create(char *name, FileOffset initialSize);
 	// Create a file (UNIX creat)
 
 	OpenFile *Open(char *name); // Open a file (UNIX open)
 
 	bool Remove(char *name); // Delete a file (UNIX unlink)
 
+	void Closed(int sector); // The last OpenFile of a removed
+							 //  file is gone
+	void Reap();			 // Free removed files now
+
+	bool Fill(FileHeader *hdr, int hdrSector, FileOffset from, FileOffset to);
+	// Allocate space for the holes in
+	//  part of an open file
+
 	void List(char* name); // List all the files in the file system
 
 	void Print(); // List all the files and their contents
@@ -105,7 +118,7 @@ public:
 
 	int CloseFile();
 	// part 3
-	void CreateDirectory(char *name);
+	bool CreateDirectory(char *name); // FALSE if there is no room
 
 	void RecursiveList(char* name);
 
@@ -113,11 +126,28 @@ public:
 
 	void PrintHeaderUse();
 
+	bool Check(bool repair); // Check the file system for consistency,
+							 //  and maybe repair it
+
+	void BeginBatch(); // Make the following operations, up
+	void EndBatch();   //  to EndBatch, a single journal
+	                   //  transaction
+
 private:
 	OpenFile *freeMapFile;	 // Bit map of free disk blocks,
 							 // represented as a file
+	PersistentBitmap *freeMap; // In-memory copy of the bit map,
+							 // kept for as long as we're mounted
+	Journal *journal;		 // Write-ahead log of metadata updates
+	DelayedWrites *delayed;	 // Writes waiting for data sectors,
+							 //  in write-back mode
+	Reaper *reaper;			 // Frees removed files
 	OpenFile *directoryFile; // "Root" directory -- list of
 							 // file names, represented as a file
+	int sectorsPerGroup;	 // Block group geometry, from the
+	int numGroups;			 //  superblock
+
+	int DirectoryGoal(int parentSector); // Where to put a new directory
 };
 
 #endif // FILESYS
@@ -0,0 +1,446 @@
+// fsck.cc
+//	Routines to check a mounted file system for consistency, and to
+//	repair it.  See fsck.h for what is checked, and why the metadata
+//	is read one sorted wave at a time.
+//
+//	The checker reads the disk through the synchronous disk, so it
+//	sees any updates still sitting in the journal or the sector cache
+//	-- it checks the file system as the kernel sees it, not just as
+//	it happens to be on disk.  It must be run while nothing else is
+//	using the file system (at boot, from main).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synchdisk.h"
+#include "filehdr.h"
+#include "openfile.h"
+#include "fslayout.h"
+#include "fsck.h"
+
+// What a sector read during the walk holds.
+const int HeaderItem = 0;   // the top-level header of a file
+const int DirBlockItem = 1; // a block of directory entries
+const int IndexItem = 2;    // an index header of a bigger file
+
+const int MaxRefs = 255; // reference counts stick here
+
+//----------------------------------------------------------------------
+// FileSystemCheck::FileSystemCheck
+// 	Initialize a check of the file system whose free map is "map".
+//	If "log", the sectors of the journal count as in use.
+//----------------------------------------------------------------------
+
+FileSystemCheck::FileSystemCheck(PersistentBitmap *map, bool log)
+{
+    freeMap = map;
+    journaled = log;
+    numSectors = kernel->synchDisk->NumSectors();
+    refs = new unsigned char[numSectors];
+    maxNodes = NumDirEntries;
+    nodes = new CheckNode[maxNodes];
+    numNodes = 0;
+    waves = new WaveQueue();
+    Reset();
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::~FileSystemCheck
+// 	De-allocate everything the walk found.
+//----------------------------------------------------------------------
+
+FileSystemCheck::~FileSystemCheck()
+{
+    Reset();
+    delete[] refs;
+    delete[] nodes;
+    delete waves;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::Reset
+// 	Forget the results of the last Scan.
+//----------------------------------------------------------------------
+
+void FileSystemCheck::Reset()
+{
+    for (int i = 0; i < numNodes; i++)
+    {
+        delete[] nodes[i].path;
+        if (nodes[i].table != NULL)
+            delete[] nodes[i].table;
+    }
+    numNodes = 0;
+    waves->Clear();
+
+    numFiles = numDirs = numUsed = 0;
+    numDoubles = numNotMarked = numLeaked = 0;
+    numBadHeaders = numBadEntries = 0;
+    numReads = numWaves = 0;
+
+    memset(refs, 0, numSectors);
+    if (journaled)
+        for (int i = JournalSector; i <= JournalSector + JournalSize; i++)
+            refs[i] = 1;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::AddNode
+// 	Remember a file or directory found during the walk, and return
+//	its index.
+//
+//	"sector" is where its header is
+//	"isDir" is TRUE for a directory
+//	"parent", "entry" say which directory entry names it (-1 if none)
+//	"parentPath", "name" give its full name, for messages
+//----------------------------------------------------------------------
+
+int FileSystemCheck::AddNode(int sector, bool isDir, int parent, int entry,
+                             char *parentPath, const char *name)
+{
+    if (numNodes == maxNodes)
+    {
+        CheckNode *bigger = new CheckNode[maxNodes * 2];
+        memcpy(bigger, nodes, maxNodes * sizeof(CheckNode));
+        delete[] nodes;
+        nodes = bigger;
+        maxNodes *= 2;
+    }
+
+    CheckNode *node = &nodes[numNodes];
+    node->sector = sector;
+    node->isDir = isDir;
+    node->parent = parent;
+    node->entry = entry;
+    node->bad = FALSE;
+    node->dirty = FALSE;
+    node->table = NULL;
+    node->sectorsLeft = 0;
+    if (isDir)
+    {
+        node->table = new char[DirectoryFileSize];
+        memset(node->table, 0, DirectoryFileSize);
+        node->sectorsLeft = divRoundUp(DirectoryFileSize, SectorSize);
+    }
+
+    if (parentPath == NULL)
+    {
+        node->path = new char[strlen(name) + 1];
+        strcpy(node->path, name);
+    }
+    else
+    { // "/" + name, or parent + "/" + name
+        node->path = new char[strlen(parentPath) + strlen(name) + 2];
+        strcpy(node->path, parentPath);
+        if (strcmp(parentPath, "/") != 0)
+            strcat(node->path, "/");
+        strcat(node->path, name);
+    }
+    return numNodes++;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::Reference
+// 	Count one more use of "sector".  Return TRUE if this is the first
+//	one -- a sector seen before must not be walked again, or a header
+//	that points back at an ancestor would have us going round forever.
+//----------------------------------------------------------------------
+
+bool FileSystemCheck::Reference(int sector)
+{
+    if (refs[sector] < MaxRefs)
+        refs[sector]++;
+    return refs[sector] == 1;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::Scan
+// 	Walk everything reachable from the free map and root directory
+//	headers, then compare what is in use with the free map.  Print
+//	each problem as it is found, and return how many there were.
+//----------------------------------------------------------------------
+
+int FileSystemCheck::Scan()
+{
+    int map, root;
+
+    Reset();
+    Reference(SuperSector);
+    map = AddNode(FreeMapSector, FALSE, -1, -1, NULL, "[free map]");
+    Reference(FreeMapSector);
+    waves->Queue(FreeMapSector, HeaderItem, map, 0, FreeMapFileSize(numSectors));
+    root = AddNode(DirectorySector, TRUE, -1, -1, NULL, "/");
+    Reference(DirectorySector);
+    waves->Queue(DirectorySector, HeaderItem, root, 0, DirectoryFileSize);
+
+    while (waves->NextWave())
+    {
+        int waveSize = waves->Size();
+
+        numWaves++;
+        DEBUG(dbgFile, "Check wave " << numWaves << ": " << waveSize
+                  << " sectors, " << waves->Item(0)->sector << " to "
+                  << waves->Item(waveSize - 1)->sector);
+
+        for (int i = 0; i < waveSize; i++)
+        {
+            numReads++;
+            if (waves->Item(i)->kind == DirBlockItem)
+                ReadDirectoryBlock(waves->Item(i));
+            else
+                CheckHeader(waves->Item(i));
+        }
+    }
+
+    for (int i = 0; i < numSectors; i++)
+    {
+        if (refs[i] > 0)
+            numUsed++;
+        if (refs[i] > 1)
+        {
+            printf("fsck: sector %d is used %s%d times\n", i,
+                   refs[i] == MaxRefs ? "at least " : "", refs[i]);
+            numDoubles++;
+        }
+        if (refs[i] > 0 && !freeMap->Test(i))
+        {
+            DEBUG(dbgFile, "Sector " << i << " is in use but free in the map");
+            numNotMarked++;
+        }
+        else if (refs[i] == 0 && freeMap->Test(i))
+        {
+            DEBUG(dbgFile, "Sector " << i << " is marked but not in use");
+            numLeaked++;
+        }
+    }
+
+    return numBadHeaders + numBadEntries + numDoubles + numNotMarked +
+           numLeaked;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::CheckHeader
+// 	Read a file header, make sure it makes sense, and count (and
+//	queue, if they hold more metadata) the sectors it points to.
+//	A header that doesn't make sense makes its whole file bad; we
+//	don't follow anything it points to.
+//----------------------------------------------------------------------
+
+void FileSystemCheck::CheckHeader(WaveItem *item)
+{
+    FileHeader *hdr = new FileHeader;
+    FileOffset numBytes, level;
+    int count, i;
+    bool ok;
+
+    if (item->kind == IndexItem)
+        hdr->FetchIndexFrom(item->sector);
+    else
+        hdr->FetchFrom(item->sector); // an inline file has no sectors
+    numBytes = hdr->FileLength();
+    count = hdr->NumSectors();
+    level = hdr->LevelSize();
+    ok = numBytes >= 0 && numBytes <= (FileOffset)numSectors * SectorSize &&
+         (item->size < 0 || numBytes == item->size);
+    for (i = 0; ok && i < count; i++)
+        ok = (hdr->DataSector(i) >= 0 && hdr->DataSector(i) < numSectors) ||
+             (hdr->DataSector(i) == HoleSector && !nodes[item->node].isDir);
+                                  // only a file may have holes
+
+    if (!ok)
+    {
+        printf("fsck: %s: bad header in sector %d\n",
+               nodes[item->node].path, item->sector);
+        nodes[item->node].bad = TRUE;
+        numBadHeaders++;
+        delete hdr;
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        int sector = hdr->DataSector(i);
+        FileOffset offset = item->offset + i * level;
+
+        if (sector == HoleSector)
+            continue; // never written
+        if (!Reference(sector))
+            continue; // reported as doubly used
+        if (level > SectorSize)
+            waves->Queue(sector, IndexItem, item->node, offset,
+                         min(level, numBytes - i * level));
+        else if (nodes[item->node].isDir)
+            waves->Queue(sector, DirBlockItem, item->node, offset, -1);
+    }
+    delete hdr;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::ReadDirectoryBlock
+// 	Read one sector of a directory into its table; once the last one
+//	is in, check the entries.
+//----------------------------------------------------------------------
+
+void FileSystemCheck::ReadDirectoryBlock(WaveItem *item)
+{
+    CheckNode *node = &nodes[item->node];
+    char *data = new char[SectorSize];
+
+    kernel->synchDisk->ReadSector(item->sector, data);
+    memcpy(node->table + item->offset, data,
+           min((FileOffset)SectorSize, (FileOffset)DirectoryFileSize - item->offset));
+    delete[] data;
+
+    if (--node->sectorsLeft == 0)
+        CheckDirectory(item->node);
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::CheckDirectory
+// 	Go through the entries of a directory, queueing the header of
+//	everything it names for the next wave.  An entry whose header
+//	sector is off the disk, or already in use by something else
+//	(which includes a second link to a directory), is bad.
+//----------------------------------------------------------------------
+
+void FileSystemCheck::CheckDirectory(int dir)
+{
+    DirectoryEntry *table = (DirectoryEntry *)nodes[dir].table;
+    char name[FileNameMaxLen + 1];
+
+    for (int i = 0; i < NumDirEntries; i++)
+    {
+        if (!table[i].inUse)
+            continue;
+        strncpy(name, table[i].name, FileNameMaxLen);
+        name[FileNameMaxLen] = '\0';
+
+        int sector = table[i].sector;
+        int child = AddNode(sector, table[i].isDir, dir, i,
+                            nodes[dir].path, name);
+        if (sector < 0 || sector >= numSectors)
+        {
+            printf("fsck: %s: header sector %d is off the disk\n",
+                   nodes[child].path, sector);
+            nodes[child].bad = TRUE;
+            numBadEntries++;
+        }
+        else if (!Reference(sector))
+        {
+            printf("fsck: %s: header sector %d is already in use\n",
+                   nodes[child].path, sector);
+            nodes[child].bad = TRUE;
+            numBadEntries++;
+        }
+        else
+        {
+            if (table[i].isDir)
+                numDirs++;
+            else
+                numFiles++;
+            waves->Queue(sector, HeaderItem, child, 0,
+                         table[i].isDir ? (FileOffset)DirectoryFileSize : -1);
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::Report
+// 	Summarize what the last Scan found.
+//----------------------------------------------------------------------
+
+void FileSystemCheck::Report()
+{
+    printf("fsck: %d files, %d directories, %d of %d sectors in use\n",
+           numFiles, numDirs, numUsed, numSectors);
+    printf("fsck: %d bad headers, %d bad entries, %d sectors doubly used, "
+           "%d not marked, %d leaked\n",
+           numBadHeaders, numBadEntries, numDoubles, numNotMarked,
+           numLeaked);
+    printf("fsck: read %d metadata sectors in %d sorted passes\n",
+           numReads, numWaves);
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::RemoveBadEntries
+// 	Take every file or directory the last Scan found to be bad out of
+//	the directory that names it, and write the changed directories
+//	back.  What the removed files used is left for FixFreeMap, after
+//	another Scan.  Return the number of entries removed.
+//
+//	Sectors used by two files are not touched: there is no telling
+//	which of them the data really belongs to.
+//----------------------------------------------------------------------
+
+int FileSystemCheck::RemoveBadEntries()
+{
+    int removed = 0;
+    int i;
+
+    for (i = 0; i < numNodes; i++)
+    {
+        if (!nodes[i].bad)
+            continue;
+        if (nodes[i].parent < 0)
+        {
+            printf("fsck: %s: can't repair\n", nodes[i].path);
+            continue;
+        }
+        CheckNode *dir = &nodes[nodes[i].parent];
+        ((DirectoryEntry *)dir->table)[nodes[i].entry].inUse = FALSE;
+        dir->dirty = TRUE;
+        printf("fsck: removing %s\n", nodes[i].path);
+        removed++;
+    }
+
+    for (i = 0; i < numNodes; i++)
+    {
+        if (!nodes[i].dirty)
+            continue;
+        OpenFile *file = new OpenFile(nodes[i].sector);
+        file->WriteAt(nodes[i].table, DirectoryFileSize, 0);
+        delete file;
+        nodes[i].dirty = FALSE;
+    }
+    return removed;
+}
+
+//----------------------------------------------------------------------
+// FileSystemCheck::FixFreeMap
+// 	Make the free map agree with what the last Scan found in use.
+//	The caller writes the map back.  Return the number of bits
+//	changed.
+//
+//	If the free map or root directory header is itself broken, the
+//	walk saw next to nothing, and "fixing" the map would free the
+//	whole disk -- so leave it alone.
+//----------------------------------------------------------------------
+
+int FileSystemCheck::FixFreeMap()
+{
+    int changed = 0;
+
+    if (nodes[0].bad || nodes[1].bad)
+    {
+        printf("fsck: not repairing the free map\n");
+        return 0;
+    }
+    for (int i = 0; i < numSectors; i++)
+    {
+        if (refs[i] > 0 && !freeMap->Test(i))
+        {
+            freeMap->Mark(i);
+            changed++;
+        }
+        else if (refs[i] == 0 && freeMap->Test(i))
+        {
+            freeMap->Clear(i);
+            changed++;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,102 @@
+// fsck.h
+//	Data structures for checking the consistency of a mounted
+//	file system, and for repairing what can be repaired.
+//
+//	The checker walks every directory and every (multi-level) file
+//	header, counting how many times each disk sector is referenced,
+//	and then compares the counts against the free map:
+//
+//	   a sector referenced twice is "doubly used";
+//	   a sector referenced but clear in the map is "not marked";
+//	   a sector set in the map but never referenced is "leaked".
+//
+//	It also notices headers whose contents make no sense (sizes that
+//	are wrong or bigger than the disk, sector numbers off the end of
+//	the disk), and directory entries pointing at them.
+//
+//	The walk goes breadth first, one "wave" of the tree at a time
+//	(cf. wave.h): all the headers (and directory blocks) found while
+//	processing one wave are sorted by sector number and read in a
+//	single sweep across the disk, rather than in the order the tree
+//	happens to list them.  On a full disk this is the difference
+//	between one pass of the disk head per level of the tree and one
+//	seek per header.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef FSCK_H
+#define FSCK_H
+
+#include "pbitmap.h"
+#include "wave.h"
+
+// One file, directory, or other header tree found during the walk.
+class CheckNode
+{
+public:
+    int sector;     // sector holding its (top-level) header
+    bool isDir;     // is it a directory?
+    int parent;     // index of the directory naming it, or
+                    //  -1 for the free map and the root
+    int entry;      // which entry of the parent names it
+    char *path;     // full name, for messages
+    bool bad;       // is the header (or the entry) broken?
+    char *table;    // contents of a directory
+    int sectorsLeft; // directory blocks not yet read
+    bool dirty;     // has repair changed "table"?
+};
+
+// The following class defines a file system check.  It is run by
+// FileSystem::Check, which holds the free map; repairs are made by
+// the caller inside a journal transaction.
+
+class FileSystemCheck
+{
+public:
+    FileSystemCheck(PersistentBitmap *freeMap, bool journaled);
+    // Check against "freeMap"; if "journaled",
+    //  the log area is in use too
+    ~FileSystemCheck();
+
+    int Scan(); // Walk the whole file system; return
+                //  the number of problems found
+
+    void Report(); // Print what the last Scan found
+
+    int RemoveBadEntries(); // Remove entries naming broken headers
+                            //  from their directories; return how many
+    int FixFreeMap();       // Mark referenced sectors, clear leaked
+                            //  ones; return how many bits changed
+
+private:
+    PersistentBitmap *freeMap; // the map being checked
+    int numSectors;            // how big the disk is
+    bool journaled;            // reserve the log area?
+    unsigned char *refs;       // # of references to each sector
+
+    CheckNode *nodes; // everything found so far
+    int numNodes;
+    int maxNodes;
+
+    WaveQueue *waves; // sectors to read, a wave at a time
+                      //  (WaveItem::kind is in fsck.cc)
+
+    int numFiles, numDirs, numUsed;         // what we found
+    int numDoubles, numNotMarked, numLeaked;
+    int numBadHeaders, numBadEntries;
+    int numReads, numWaves;                 // what it cost
+
+    void Reset();
+    int AddNode(int sector, bool isDir, int parent, int entry,
+                char *parentPath, const char *name);
+    bool Reference(int sector);
+    void CheckHeader(WaveItem *item);
+    void ReadDirectoryBlock(WaveItem *item);
+    void CheckDirectory(int node);
+};
+
+#endif // FSCK_H
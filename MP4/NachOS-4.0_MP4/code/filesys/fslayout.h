@@ -0,0 +1,72 @@
+// fslayout.h
+//	Where the file system keeps its metadata on disk.
+//
+//	These are shared by the file system proper and by host-side tools
+//	that build or check disk images without running Nachos (see
+//	../../mkfs), so that the two can never disagree about the format.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef FSLAYOUT_H
+#define FSLAYOUT_H
+
+#include "disk.h"
+#include "bitmap.h"
+#include "directory.h"
+
+// The superblock, in the first sector of the disk, says how the disk
+// was formatted: since the size of the disk is chosen at format time,
+// everything else (the size of the free map, which sectors exist)
+// follows from it.
+#define SuperSector 0
+
+class SuperBlock
+{
+public:
+    int magic;           // SuperMagic, if this is a Nachos file system
+    int sectorSize;      // must be SectorSize
+    int sectorsPerTrack; // disk geometry when formatted
+    int numSectors;      // # of sectors in the file system
+    int sectorsPerGroup; // # of sectors in each block group
+    int numGroups;       // # of block groups (the last may be short)
+};
+
+const int SuperMagic = 0x4e616368;
+
+// The disk is divided into block groups of whole tracks.  A directory's
+// header, and the headers, index blocks and data of the files in it,
+// are allocated in the directory's group where possible, so that
+// scanning a directory and reading its files moves the disk head
+// across a few tracks rather than across the whole disk; new
+// directories go in their parent's group unless it is fuller than
+// average (cf. FileSystem::CreateDirectory).
+#define TracksPerGroup 64
+#define SectorsPerGroup (TracksPerGroup * SectorsPerTrack)
+
+// Sectors containing the file headers for the bitmap of free sectors,
+// and the directory of files.  These file headers are placed in well-known
+// sectors, so that they can be located on boot-up.
+#define FreeMapSector 1
+#define DirectorySector 2
+
+// The metadata journal: a header in a well-known sector, followed by
+// a contiguous log, so that a commit is one sequential run of writes.
+#define JournalSector 3
+#define JournalSize 512
+
+// Magic number in the log header, so we can tell a disk that was
+// formatted with a log from one that wasn't.
+const int JournalMagic = 0x4a726e6c;
+
+// Initial file sizes for the bitmap and directory; until the file system
+// supports extensible files, the directory size sets the maximum number
+// of files that can be loaded onto the disk.
+// (NumDirEntries is in directory.h.)
+#define FreeMapFileSize(numSectors) divRoundUp(numSectors, BitsInByte)
+#define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
+
+#endif // FSLAYOUT_H
@@ -0,0 +1,474 @@
+// journal.cc
+//	Routines to manage the write-ahead log of file system metadata.
+//
+//	On-disk layout, starting at "headerSector":
+//
+//	   header sector:  magic number, commit sequence number, and the
+//			   number of log sectors holding committed records
+//	   log sectors:    a sequence of records, each one a descriptor
+//			   sector (count, followed by up to
+//			   ImagesPerDescriptor home sector numbers)
+//			   followed by that many sector images
+//
+//	A commit writes its descriptors and images after the records
+//	already in the log, and only then rewrites the header to cover
+//	them.  Since a single sector write is atomic, a crash before the
+//	header write loses the transaction, and a crash after it is
+//	repaired by Recover.
+//
+//	With group commit, the records of several transactions go out
+//	together.  Only the newest copy of each sector is written; since
+//	the group is committed by a single header write, that is still
+//	all-or-nothing.
+//
+//	The journal does its own I/O with SynchDisk::WriteThrough, so
+//	that log writes are never delayed or reordered by the disk cache.
+//
+//	A transaction that does not fit in the log on its own is
+//	committed in log-sized pieces: first the operations of a batch
+//	that are already done, and only if the one under way is too big
+//	by itself, part of that.  The file system writes directory and
+//	free map sectors last, so a crash part way through such an
+//	operation can at worst leave sectors marked in use that no file
+//	points to.  An operation that has been committed in part cannot
+//	be aborted.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synchdisk.h"
+#include "journal.h"
+#include "fslayout.h"
+
+// # of home sector numbers that fit in a descriptor sector, after
+// the count
+const int ImagesPerDescriptor = SectorSize / sizeof(int) - 1;
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the in-memory state of the journal.  The journal is
+//	disabled until Format or Recover finds (or puts) a log on disk.
+//
+//	"headerSector" -- the sector containing the log header
+//	"numLogSectors" -- the # of log sectors following the header
+//----------------------------------------------------------------------
+
+Journal::Journal(int headerSector, int numLogSectors)
+{
+    this->headerSector = headerSector;
+    this->numLogSectors = numLogSectors;
+    enabled = FALSE;
+    groupCommit = FALSE;
+    depth = 0;
+    sequence = 0;
+    logUsed = 0;
+
+    maxEntries = numLogSectors;
+    entries = new JournalEntry[maxEntries];
+    numEntries = 0;
+    numCommitted = 0;
+    numClosed = 0;
+    lock = new Lock("journal lock");
+    busy = new Lock("journal transaction lock");
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the in-memory state.  Committed sectors that were
+//	never checkpointed are safe in the log, and will be replayed
+//	at the next mount.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    delete[] entries;
+    delete lock;
+    delete busy;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Initialize an empty log on a freshly formatted disk.
+//----------------------------------------------------------------------
+
+void Journal::Format()
+{
+    enabled = TRUE;
+    sequence = 0;
+    logUsed = 0;
+    numEntries = numCommitted = numClosed = 0;
+    WriteHeader();
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Read the log header, and copy every committed sector image in
+//	the log to its home location, in the order they were committed.
+//	Then empty the log.
+//
+//	Return FALSE if the disk has no log (it was formatted before the
+//	journal existed); in that case the journal stays disabled, and
+//	writes go straight to disk as before.
+//----------------------------------------------------------------------
+
+bool Journal::Recover()
+{
+    int buf[SectorSize / sizeof(int)];
+    int descriptor[SectorSize / sizeof(int)];
+    char image[SectorSize];
+    int pos, used, count;
+
+    kernel->synchDisk->ReadSector(headerSector, (char *)buf);
+    if (buf[0] != JournalMagic)
+    {
+        DEBUG(dbgFile, "No journal on disk, running without one.");
+        return FALSE;
+    }
+    sequence = buf[1];
+    used = buf[2];
+    ASSERT(used >= 0 && used <= numLogSectors);
+
+    DEBUG(dbgFile, "Replaying " << used << " journal sectors.");
+    for (pos = 0; pos < used; pos += 1 + count)
+    {
+        kernel->synchDisk->ReadSector(headerSector + 1 + pos, (char *)descriptor);
+        count = descriptor[0];
+        ASSERT(count > 0 && count <= ImagesPerDescriptor);
+        for (int i = 0; i < count; i++)
+        {
+            kernel->synchDisk->ReadSector(headerSector + 1 + pos + 1 + i, image);
+            kernel->synchDisk->WriteThrough(descriptor[1 + i], image);
+        }
+    }
+
+    enabled = TRUE;
+    logUsed = 0;
+    numEntries = numCommitted = numClosed = 0;
+    if (used > 0)
+        WriteHeader();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin/End/Abort
+// 	Bracket a file system operation.  Transactions may nest (Remove
+//	is called from RecursiveRemove); only the outermost End closes
+//	the transaction, and commits it unless group commit is on.
+//
+//	Abort discards every sector captured since the matching Begin,
+//	so a failed operation inside a larger batch (see
+//	FileSystem::BeginBatch) undoes only itself.  To make that
+//	possible, a sector written again at a deeper level gets a new
+//	entry rather than overwriting the outer level's copy.  If part
+//	of the transaction is already in the log (see Absorb), it would
+//	be replayed anyway, so we stop rather than pretend to undo it.
+//
+//	One thread at a time has a transaction open: the outermost Begin
+//	waits for any other thread's transaction to close.
+//----------------------------------------------------------------------
+
+void Journal::Begin()
+{
+    if (!busy->IsHeldByCurrentThread())
+        busy->Acquire();
+    ASSERT(depth < MaxNesting);
+    split[depth] = FALSE;
+    mark[depth++] = numEntries;
+}
+
+void Journal::End()
+{
+    ASSERT(depth > 0 && busy->IsHeldByCurrentThread());
+    if (--depth == 0)
+    {
+        numClosed = numEntries;
+        if (!groupCommit)
+            Commit();
+        busy->Release();
+    }
+}
+
+void Journal::Abort()
+{
+    ASSERT(depth > 0 && busy->IsHeldByCurrentThread());
+    depth--;
+    ASSERT(!split[depth]); // part of it is committed already
+    numEntries = mark[depth];
+    if (depth == 0)
+        busy->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Absorb
+// 	Called by SynchDisk::WriteSector.  If the current thread has a
+//	transaction open, keep a copy of the sector and return TRUE --
+//	the caller must not write it.  Writing the same sector twice in
+//	a transaction keeps only the newest copy.
+//
+//	Outside of a transaction (e.g. for file data, even while another
+//	thread has a transaction open), the write goes to disk.  If the
+//	sector still has a copy waiting in the log (or in
+//	a group not yet committed), we commit and checkpoint first, so
+//	that neither the checkpoint nor a later replay can overwrite the
+//	new contents with the old.
+//
+//	Both cases may write the log, so they hold the journal lock
+//	against a concurrent Commit from the disk flusher.
+//
+//	"sector" -- the disk sector being written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+bool Journal::Absorb(int sector, char *data)
+{
+    int i;
+
+    if (!enabled)
+        return FALSE;
+    lock->Acquire();
+    if (depth == 0 || !busy->IsHeldByCurrentThread())
+    {
+        if (FindEntry(sector, numCommitted, numEntries) >= 0)
+            CommitUpTo(numClosed); // a finished group still has a copy
+        if (FindEntry(sector, 0, numEntries) >= 0)
+            Checkpoint();
+        lock->Release();
+        return FALSE;
+    }
+
+    i = FindEntry(sector, mark[depth - 1], numEntries);
+    if (i < 0)
+    {
+        if (LogSectorsFor(numEntries - numCommitted + 1) > numLogSectors)
+        {
+            if (numClosed > numCommitted)
+                CommitUpTo(numClosed); // make room by committing the group so far
+            if (LogSectorsFor(numEntries - numCommitted + 1) > numLogSectors &&
+                mark[depth - 1] > numCommitted)
+                CommitUpTo(mark[depth - 1]); // ... and the batch so far
+            if (LogSectorsFor(numEntries - numCommitted + 1) > numLogSectors)
+            {
+                DEBUG(dbgFile, "Transaction too big for the journal, committing part of it.");
+                CommitUpTo(numEntries);
+            }
+        }
+        if (numEntries == maxEntries)
+            Checkpoint();
+        i = numEntries++;
+        entries[i].sector = sector;
+    }
+    bcopy(data, entries[i].data, SectorSize);
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Lookup
+// 	Called by SynchDisk::ReadSector.  If the journal holds a copy of
+//	"sector" that is newer than the one on disk, return it in "data".
+//
+//	Only the thread with the transaction open sees its sectors;
+//	other threads (walking a path, or checking the disk) get the
+//	copy from before the transaction, since it may yet be aborted.
+//----------------------------------------------------------------------
+
+bool Journal::Lookup(int sector, char *data)
+{
+    int i;
+
+    if (!enabled)
+        return FALSE;
+    if (busy->IsHeldByCurrentThread())
+        i = FindEntry(sector, 0, numEntries);
+    else
+        i = FindEntry(sector, 0, numClosed);
+    if (i < 0)
+        return FALSE;
+    bcopy(entries[i].data, data, SectorSize);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit every finished transaction that is not yet in the log.
+//	An open transaction (if any) is left alone.
+//----------------------------------------------------------------------
+
+void Journal::Commit()
+{
+    lock->Acquire();
+    CommitUpTo(numClosed);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::CommitUpTo
+// 	Append the captured sectors before index "last" to the log, as
+//	one sequential run of descriptor and image sectors, then write
+//	the header to make them durable.  Checkpoint first if they don't
+//	fit behind what is already in the log.
+//
+//	When several transactions go out together, older copies of a
+//	sector that is written again later in the group are dropped.
+//----------------------------------------------------------------------
+
+void Journal::CommitUpTo(int last)
+{
+    int numNew, keep, need, pos, count;
+    int descriptor[SectorSize / sizeof(int)];
+
+    if (!enabled || last == numCommitted)
+        return;
+
+    // squeeze out superseded copies
+    keep = numCommitted;
+    for (int i = numCommitted; i < last; i++)
+    {
+        int j;
+        for (j = i + 1; j < last; j++)
+            if (entries[j].sector == entries[i].sector)
+                break;
+        if (j == last)
+            entries[keep++] = entries[i];
+    }
+    for (int i = last; i < numEntries; i++)
+        entries[keep + i - last] = entries[i];
+    numEntries -= last - keep;
+    numClosed = max(numClosed - (last - keep), keep);
+    for (int d = 0; d < depth; d++)
+    {
+        if (mark[d] < last)
+            split[d] = TRUE; // its start is going into the log
+        mark[d] = max(mark[d] - (last - keep), numClosed);
+    }
+
+    numNew = keep - numCommitted;
+    need = LogSectorsFor(numNew);
+    ASSERT(need <= numLogSectors);
+    if (logUsed + need > numLogSectors)
+    {
+        keep = numNew;
+        Checkpoint(); // moves the uncommitted entries to the front
+    }
+
+    DEBUG(dbgFile, "Committing " << numNew << " sectors to the journal.");
+    pos = headerSector + 1 + logUsed;
+    for (int first = numCommitted; first < keep; first += count)
+    {
+        count = min(keep - first, ImagesPerDescriptor);
+        memset(descriptor, 0, sizeof(descriptor));
+        descriptor[0] = count;
+        for (int i = 0; i < count; i++)
+            descriptor[1 + i] = entries[first + i].sector;
+        kernel->synchDisk->WriteThrough(pos++, (char *)descriptor);
+        for (int i = 0; i < count; i++)
+            kernel->synchDisk->WriteThrough(pos++, entries[first + i].data);
+    }
+
+    logUsed += need;
+    numCommitted = keep;
+    WriteHeader(); // commit point
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Write the newest committed copy of each sector to its home
+//	location, in increasing sector order to keep seeks short, and
+//	then empty the log.  Sectors of the open transaction (if any)
+//	stay in memory.
+//----------------------------------------------------------------------
+
+void Journal::Checkpoint()
+{
+    int *order, numOrder = 0;
+
+    if (!enabled || (numCommitted == 0 && logUsed == 0))
+        return;
+
+    // collect the newest committed copy of each sector, sorted by
+    // sector number (insertion sort -- there are at most a few
+    // hundred of them)
+    order = new int[numCommitted];
+    for (int i = 0; i < numCommitted; i++)
+    {
+        int j;
+        for (j = i + 1; j < numCommitted; j++)
+            if (entries[j].sector == entries[i].sector)
+                break;
+        if (j < numCommitted)
+            continue; // superseded by a later commit
+        j = numOrder++;
+        while (j > 0 && entries[order[j - 1]].sector > entries[i].sector)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    DEBUG(dbgFile, "Checkpointing " << numOrder << " journal sectors.");
+    for (int i = 0; i < numOrder; i++)
+        kernel->synchDisk->WriteThrough(entries[order[i]].sector,
+                                        entries[order[i]].data);
+    delete[] order;
+
+    logUsed = 0;
+    WriteHeader();
+
+    // keep only what is not yet committed
+    for (int i = numCommitted; i < numEntries; i++)
+        entries[i - numCommitted] = entries[i];
+    numEntries -= numCommitted;
+    numClosed -= numCommitted;
+    for (int d = 0; d < depth; d++)
+        mark[d] -= numCommitted;
+    numCommitted = 0;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHeader
+// 	Write the log header.  This is the commit point: records beyond
+//	"logUsed" are ignored by Recover.
+//----------------------------------------------------------------------
+
+void Journal::WriteHeader()
+{
+    int buf[SectorSize / sizeof(int)];
+
+    memset(buf, 0, sizeof(buf));
+    buf[0] = JournalMagic;
+    buf[1] = ++sequence;
+    buf[2] = logUsed;
+
+    kernel->synchDisk->WriteThrough(headerSector, (char *)buf);
+}
+
+//----------------------------------------------------------------------
+// Journal::FindEntry
+// 	Return the index of the newest captured copy of "sector" at or
+//	after index "from" and before index "to", or -1 if there is none.
+//----------------------------------------------------------------------
+
+int Journal::FindEntry(int sector, int from, int to)
+{
+    for (int i = to - 1; i >= from; i--)
+        if (entries[i].sector == sector)
+            return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Journal::LogSectorsFor
+// 	Return the # of log sectors needed to commit "numImages" sector
+//	images: the images themselves, plus their descriptors.
+//----------------------------------------------------------------------
+
+int Journal::LogSectorsFor(int numImages)
+{
+    return numImages + divRoundUp(numImages, ImagesPerDescriptor);
+}
+
@@ -0,0 +1,133 @@
+// journal.h
+//	Data structures for a write-ahead log ("journal") of file system
+//	metadata updates.
+//
+//	A file system operation such as Create touches several sectors --
+//	the new file header, a directory sector, a few sectors of the
+//	free map.  Without a log, a crash between those writes leaves the
+//	disk inconsistent.  With the log, the operation is bracketed by
+//	Begin/End; every sector written in between is captured in memory
+//	instead of going to disk.  End appends the captured sectors to a
+//	reserved, contiguous log region in one sequential pass, then
+//	writes the log header -- the commit point.
+//
+//	Committed sectors are copied to their real ("home") locations
+//	lazily, at checkpoint time, once the log fills up.  Until then the
+//	in-memory copies answer reads of those sectors, so a sector that
+//	is updated by many operations (e.g. the first free map sector) is
+//	written home only once.
+//
+//	On mount, Recover replays every committed transaction found in
+//	the log, so the disk reflects either all or none of each one.
+//
+//	With group commit on (the disk is in write-back mode), End does
+//	not write the log itself; finished transactions accumulate in
+//	memory and are committed together, with one header write, the
+//	next time the disk cache is flushed.  A crash loses the
+//	transactions since the last flush, but never half of one.
+//
+//	The journal sits underneath the file system, in SynchDisk: while
+//	a transaction is open, SynchDisk::WriteSector hands the sector to
+//	Absorb, and SynchDisk::ReadSector asks Lookup first.  Only the
+//	writes of the thread that opened the transaction are captured;
+//	file data written by other threads meanwhile goes to disk as usual.
+//	Likewise, only that thread reads back the sectors of its open
+//	transaction; other threads see them once it is closed.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+
+// Deepest nesting of Begin/End
+const int MaxNesting = 8;
+
+// A sector captured by the journal, together with where it belongs.
+
+class JournalEntry
+{
+public:
+    int sector;             // home location of this sector
+    char data[SectorSize];  // its contents
+};
+
+// The following class defines the metadata journal.  The log occupies
+// "numLogSectors" contiguous sectors following the log header sector.
+
+class Journal
+{
+public:
+    Journal(int headerSector, int numLogSectors);
+    // Initialize the journal, stored at
+    //  "headerSector" and the sectors after it
+    ~Journal(); // De-allocate the in-memory state
+
+    void Format();  // Write an empty log to disk
+    bool Recover(); // Replay any committed transactions.
+                    // Return FALSE (and stay disabled)
+                    // if the disk was formatted without
+                    // a log
+
+    void Begin(); // Start a transaction; may be nested
+    void End();   // Finish a transaction; the outermost
+                  //  End commits it to the log
+    void Abort(); // Throw away the innermost open
+                  //  transaction
+    void Commit(); // Write finished transactions to the log
+
+    bool IsEnabled() { return enabled; } // Is there a log on this disk?
+
+    void SetGroupCommit(bool on) { groupCommit = on; }
+    // Should End leave the commit to the
+    //  next Commit call?
+    bool HasPending() { return numClosed > numCommitted; }
+    // Are there finished transactions
+    //  waiting for Commit?
+
+    void Checkpoint(); // Write committed sectors to their home
+                       //  locations and empty the log
+
+    bool Absorb(int sector, char *data); // Capture a sector write.
+                                         // Return FALSE if the caller
+                                         // should write it to disk
+    bool Lookup(int sector, char *data); // Return TRUE, and the newest
+                                         // captured copy the current
+                                         // thread may see, if there
+                                         // is one
+
+private:
+    int headerSector;   // sector holding the log header
+    int numLogSectors;  // # of sectors in the log proper
+    bool enabled;       // is there a log on this disk?
+    bool groupCommit;   // End just closes the transaction
+    int depth;          // nesting level of Begin/End
+    int mark[MaxNesting]; // numEntries at each open Begin
+    bool split[MaxNesting]; // has part of that level been
+                          //  committed (so it cannot abort)?
+    int sequence;       // # of commits since format
+    int logUsed;        // # of log sectors holding committed records
+    Lock *lock;         // one thread at a time writes the log
+    Lock *busy;         // held by the thread with a transaction open
+
+    JournalEntry *entries; // captured sectors, oldest first:
+    int numEntries;        //  [0, numCommitted) are in the log,
+    int numCommitted;      //  [numCommitted, numClosed) are finished
+    int numClosed;         //  but not yet in the log, and
+    int maxEntries;        //  [numClosed, numEntries) are open
+
+    void CommitUpTo(int last);       // append entries before "last" to the log
+    void WriteHeader();              // write the log header (commit point)
+    int FindEntry(int sector, int from, int to);
+                                     // newest entry for "sector" in
+                                     //  ["from", "to")
+    int LogSectorsFor(int numImages);    // log space "numImages" sectors need
+};
+
+#endif // JOURNAL_H
@@ -17,6 +17,9 @@
 #include "filehdr.h"
 #include "openfile.h"
 #include "synchdisk.h"
+#include "journal.h"
+#include "delayed.h"
+#include "rangelock.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
@@ -30,7 +33,10 @@ OpenFile::OpenFile(int sector)
 {
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    seekLock = new Lock("seek position");
+    rangeLock = RangeLock::Open(sector);
 }
 
 //----------------------------------------------------------------------
@@ -40,6 +46,9 @@ OpenFile::OpenFile(int sector)
 
 OpenFile::~OpenFile()
 {
+    if (RangeLock::Close(rangeLock)) // removed while we had it open
+        kernel->fileSystem->Closed(hdrSector);
+    delete seekLock;
     delete hdr;
 }
 
@@ -51,9 +60,11 @@ OpenFile::~OpenFile()
 //	"position" -- the location within the file for the next Read/Write
 //----------------------------------------------------------------------
 
-void OpenFile::Seek(int position)
+void OpenFile::Seek(FileOffset position)
 {
+    seekLock->Acquire();
     seekPosition = position;
+    seekLock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -64,6 +75,14 @@ void OpenFile::Seek(int position)
 //
 //	Implemented using the more primitive ReadAt/WriteAt.
 //
+//	Threads may share an OpenFile, so each call first claims its
+//	bytes, moving seekPosition past them in one atomic step: two
+//	concurrent Writes never get the same bytes, and each one's data
+//	ends up in one piece, one after the other, as with O_APPEND in
+//	UNIX.  If fewer bytes are transferred than claimed (at the end of
+//	the file, or when the disk is full), the rest are given back
+//	unless someone has claimed bytes after them meanwhile.
+//
 //	"into" -- the buffer to contain the data to be read from disk
 //	"from" -- the buffer containing the data to be written to disk
 //	"numBytes" -- the number of bytes to transfer
@@ -71,18 +90,50 @@ void OpenFile::Seek(int position)
 
 int OpenFile::Read(char *into, int numBytes)
 {
-    int result = ReadAt(into, numBytes, seekPosition);
-    seekPosition += result;
+    FileOffset position = Claim(numBytes);
+    int result = ReadAt(into, numBytes, position);
+
+    if (result < numBytes)
+        Unclaim(position + result, position + numBytes);
     return result;
 }
 
 int OpenFile::Write(char *into, int numBytes)
 {
-    int result = WriteAt(into, numBytes, seekPosition);
-    seekPosition += result;
+    FileOffset position = Claim(numBytes);
+    int result = WriteAt(into, numBytes, position);
+
+    if (result < numBytes)
+        Unclaim(position + result, position + numBytes);
     return result;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::Claim/Unclaim
+// 	Claim returns seekPosition, and moves it "numBytes" further on.
+//	Unclaim moves it back to "from" if it is still at "to", the end
+//	of the last claim.
+//----------------------------------------------------------------------
+
+FileOffset OpenFile::Claim(int numBytes)
+{
+    FileOffset position;
+
+    seekLock->Acquire();
+    position = seekPosition;
+    seekPosition += max(numBytes, 0);
+    seekLock->Release();
+    return position;
+}
+
+void OpenFile::Unclaim(FileOffset from, FileOffset to)
+{
+    seekLock->Acquire();
+    if (seekPosition == to)
+        seekPosition = from;
+    seekLock->Release();
+}
+
 //----------------------------------------------------------------------
 // OpenFile::ReadAt/WriteAt
 // 	Read/write a portion of a file, starting at "position".
@@ -94,13 +145,39 @@ int OpenFile::Write(char *into, int numBytes)
 //	sector at a time.  Thus:
 //
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   Sectors wholly inside the request are read straight into the
+//	   caller's buffer.  The partial sectors at either end are read
+//	   into a sector buffer on the stack, and we copy out the part we
+//	   are interested in.  A hole -- part of the file never written --
+//	   reads as zeroes, without going to the disk.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   Sectors wholly inside the request are written straight from the
+//	   caller's buffer, without reading them first.  A partial sector
+//	   at either end is read into the stack buffer (usually a hit in
+//	   the disk cache, and no I/O at all for a hole), merged with the
+//	   new bytes, and written back.  Sectors are allocated for any
+//	   holes among them (cf. FileSystem::Fill); if the disk is full,
+//	   we write as much as we can.
+//
+//	Neither allocates memory (the locked range is on the stack too),
+//	so the many small writes of a copy loop or a user program cost
+//	one sector read at most.
+//
+//	The sectors touched are range locked (see rangelock.h) for the
+//	duration -- shared by ReadAt, exclusive by WriteAt -- so readers,
+//	and writers to other parts of the file, run concurrently.
+//
+//	In write-back mode, data written to a hole waits in memory until
+//	the next flush, which chooses its sector (see delayed.h); until
+//	then both ReadAt and WriteAt find it there.
+//
+//	An inline file's data is in its header sector instead.  We read
+//	the header again first, in case the file was written through
+//	another OpenFile; usually the copy is still in the disk cache.
+//	Since the header is metadata, it is written back inside a journal
+//	transaction (without one, the journal's older copy of the header,
+//	if any, would overwrite it at the next checkpoint) -- so a write
+//	to a small file is all-or-nothing.
 //
 //	"into" -- the buffer to contain the data to be read from disk
 //	"from" -- the buffer containing the data to be written to disk
@@ -109,11 +186,12 @@ int OpenFile::Write(char *into, int numBytes)
 //			read/written
 //----------------------------------------------------------------------
 
-int OpenFile::ReadAt(char *into, int numBytes, int position)
+int OpenFile::ReadAt(char *into, int numBytes, FileOffset position)
 {
-    int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    FileOffset fileLength = hdr->FileLength();
+    FileOffset i, firstSector, lastSector, start, end;
+    LockedRange range;
+    char buf[SectorSize]; // for sectors we want only part of
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0; // check request
@@ -121,28 +199,42 @@ int OpenFile::ReadAt(char *into, int numBytes, int position)
         numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
+    rangeLock->Acquire(&range, position, numBytes, FALSE);
+    if (hdr->IsInline())
+    {
+        hdr->FetchFrom(hdrSector);
+        hdr->ReadInline(into, numBytes, (int)position);
+        rangeLock->Release(&range);
+        return numBytes;
+    }
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
     for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-                                      &buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete[] buf;
+    {
+        start = max(i * SectorSize, position);
+        end = min((i + 1) * SectorSize, position + numBytes);
+        if (end - start == SectorSize) // whole sector: straight in
+            GetSector(i, &into[start - position]);
+        else
+        {
+            GetSector(i, buf);
+            bcopy(&buf[start - i * SectorSize], &into[start - position],
+                  end - start);
+        }
+    }
+    rangeLock->Release(&range);
     return numBytes;
 }
 
-int OpenFile::WriteAt(char *from, int numBytes, int position)
+int OpenFile::WriteAt(char *from, int numBytes, FileOffset position)
 {
-    int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    FileOffset fileLength = hdr->FileLength();
+    FileOffset i, firstSector, lastSector, start, end;
+    LockedRange range;
+    char buf[SectorSize]; // for sectors we change only part of
+    char *data;
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0; // check request
@@ -150,33 +242,108 @@ int OpenFile::WriteAt(char *from, int numBytes, int position)
         numBytes = fileLength - position;
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
+    rangeLock->Acquire(&range, position, numBytes, TRUE);
+    if (hdr->IsInline())
+    {
+        Journal *journal = kernel->synchDisk->GetJournal();
+
+        if (journal != NULL)
+            journal->Begin();
+        hdr->FetchFrom(hdrSector);
+        hdr->WriteInline(from, numBytes, (int)position);
+        hdr->WriteBack(hdrSector);
+        if (journal != NULL)
+            journal->End();
+        rangeLock->Release(&range);
+        return numBytes;
+    }
+
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    buf = new char[numSectors * SectorSize];
+    for (i = firstSector; i <= lastSector; i++)
+    {
+        start = max(i * SectorSize, position);
+        end = min((i + 1) * SectorSize, position + numBytes);
+        if (end - start == SectorSize) // whole sector: straight out
+            data = &from[start - position];
+        else
+        { // keep the part of the sector we don't change
+            GetSector(i, buf);
+            bcopy(&from[start - position], &buf[start - i * SectorSize],
+                  end - start);
+            data = buf;
+        }
+        if (!PutSector(i, data, (lastSector + 1) * SectorSize))
+            break; // the disk is full
+    }
+    rangeLock->Release(&range);
+    if (i <= lastSector) // only got part way
+        return (int)max(i * SectorSize - position, (FileOffset)0);
+    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::GetSector
+// 	Read sector "block" of the file into "into": from the delayed
+//	writes if it is waiting there, as zeroes (without I/O) if it is a
+//	hole, or else through the disk cache.
+//----------------------------------------------------------------------
+
+void OpenFile::GetSector(FileOffset block, char *into)
+{
+    DelayedWrites *delayed = kernel->synchDisk->GetDelayed();
+    int sector;
 
-    memset(buf, 0, sizeof(char) * numSectors * SectorSize); // dummy operation to keep valgrind happy
+    if (delayed != NULL && delayed->Read(hdrSector, (int)block, into))
+        return; // written, but not yet placed on disk
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
+    sector = hdr->ByteToSector(block * SectorSize);
+    if (sector == HoleSector)
+    { // it may have been written (or placed) since we read the header
+        hdr->FetchFrom(hdrSector);
+        sector = hdr->ByteToSector(block * SectorSize);
+    }
+    if (sector == HoleSector) // never written
+        memset(into, 0, SectorSize);
+    else
+        kernel->synchDisk->ReadSector(sector, into);
+}
 
-    // read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize],
-               SectorSize, lastSector * SectorSize);
+//----------------------------------------------------------------------
+// OpenFile::PutSector
+// 	Write "from" as sector "block" of the file.  If the sector is a
+//	hole, it is given to the delayed writes in write-back mode; else
+//	we allocate sectors for it and for the rest of the holes in the
+//	write, up to byte "end", at once.
+//
+//	Return FALSE if the disk is full.
+//----------------------------------------------------------------------
 
-    // copy in the bytes we want to change
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+bool OpenFile::PutSector(FileOffset block, char *from, FileOffset end)
+{
+    DelayedWrites *delayed = kernel->synchDisk->GetDelayed();
+    int sector;
 
-    // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-                                       &buf[(i - firstSector) * SectorSize]);
-    delete[] buf;
-    return numBytes;
+    if (delayed != NULL && delayed->Update(hdrSector, (int)block, from))
+        return TRUE; // still waiting to be placed
+
+    sector = hdr->ByteToSector(block * SectorSize);
+    if (sector == HoleSector && delayed != NULL)
+    {
+        hdr->FetchFrom(hdrSector); // placed since we read the header?
+        sector = hdr->ByteToSector(block * SectorSize);
+        if (sector == HoleSector) // choose the sector when it is flushed
+            return delayed->Write(hdr, hdrSector, (int)block, from);
+    }
+    if (sector == HoleSector)
+    {
+        if (!kernel->fileSystem->Fill(hdr, hdrSector, block * SectorSize, end))
+            return FALSE;
+        sector = hdr->ByteToSector(block * SectorSize);
+    }
+    kernel->synchDisk->WriteSector(sector, from);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -184,7 +351,7 @@ int OpenFile::WriteAt(char *from, int numBytes, int position)
 // 	Return the number of bytes in the file.
 //----------------------------------------------------------------------
 
-int OpenFile::Length()
+FileOffset OpenFile::Length()
 {
     return hdr->FileLength();
 }
@@ -9,9 +9,13 @@
 //
 //	The other is the "real" implementation, that turns these
 //	operations into read and write disk sector requests.
-//	In this baseline implementation of the file system, we don't
-//	worry about concurrent accesses to the file system
-//	by different threads.
+//	Several threads may use the same file at once, even the same
+//	OpenFile.  Read and Write claim their bytes at the seek position
+//	atomically, so that threads sharing an OpenFile never get the
+//	same bytes; and every access locks the range of bytes it
+//	touches, in a RangeLock shared by all OpenFiles of the file
+//	(cf. rangelock.h), so that overlapping reads and writes see
+//	each other whole, while the others run concurrently.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -37,12 +41,12 @@ public:
 	}							 // open the file
 	~OpenFile() { Close(file); } // close the file
 
-	int ReadAt(char *into, int numBytes, int position)
+	int ReadAt(char *into, int numBytes, FileOffset position)
 	{
 		Lseek(file, position, 0);
 		return ReadPartial(file, into, numBytes);
 	}
-	int WriteAt(char *from, int numBytes, int position)
+	int WriteAt(char *from, int numBytes, FileOffset position)
 	{
 		Lseek(file, position, 0);
 		WriteFile(file, from, numBytes);
@@ -61,7 +65,7 @@ public:
 		return numWritten;
 	}
 
-	int Length()
+	FileOffset Length()
 	{
 		Lseek(file, 0, 2);
 		return Tell(file);
@@ -69,11 +73,13 @@ public:
 
 private:
 	int file;
-	int currentOffset;
+	FileOffset currentOffset;
 };
 
 #else // FILESYS
 class FileHeader;
+class RangeLock;
+class Lock;
 
 class OpenFile
 {
@@ -82,7 +88,7 @@ public:
 						  // at "sector" on the disk
 	~OpenFile();		  // Close the file
 
-	void Seek(int position); // Set the position from which to
+	void Seek(FileOffset position); // Set the position from which to
 							 // start reading/writing -- UNIX lseek
 
 	int Read(char *into, int numBytes); // Read/write bytes from the file,
@@ -91,19 +97,31 @@ public:
 										// and increment position in file.
 	int Write(char *from, int numBytes);
 
-	int ReadAt(char *into, int numBytes, int position);
+	int ReadAt(char *into, int numBytes, FileOffset position);
 	// Read/write bytes from the file,
 	// bypassing the implicit position.
-	int WriteAt(char *from, int numBytes, int position);
+	int WriteAt(char *from, int numBytes, FileOffset position);
 
-	int Length(); // Return the number of bytes in the
+	FileOffset Length(); // Return the number of bytes in the
 				  // file (this interface is simpler
 				  // than the UNIX idiom -- lseek to
 				  // end of file, tell, lseek back
 
 private:
 	FileHeader *hdr;  // Header for this file
-	int seekPosition; // Current position within the file
+	int hdrSector;    // Where the header lives on disk (an
+					  //  inline file's data is written there)
+	FileOffset seekPosition; // Current position within the file
+	Lock *seekLock;		  // Makes claiming bytes at seekPosition
+					  //  atomic
+	RangeLock *rangeLock;	  // Shared by every OpenFile of this file
+
+	FileOffset Claim(int numBytes);			 // Take bytes at seekPosition
+	void Unclaim(FileOffset from, FileOffset to); //  and give back unused ones
+
+	void GetSector(FileOffset block, char *into); // Read/write one whole
+	bool PutSector(FileOffset block, char *from,  //  sector of the file
+				   FileOffset end);
 };
 
 #endif // FILESYS
@@ -2,11 +2,18 @@
 //	Routines to manage a persistent bitmap -- a bitmap that is
 //	stored on disk.
 //
+//	The file system keeps the free sector map in memory for as
+//	long as it is mounted, so most operations only touch a handful
+//	of bits.  We track which sectors of the bitmap file those bits
+//	fall in, and only write those sectors back.
+//
 // Copyright (c) 1992,1993,1995 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
+#include "disk.h"
 #include "pbitmap.h"
 
 //----------------------------------------------------------------------
@@ -16,11 +23,19 @@
 //
 //	"numItems" is the number of bits in the bitmap.
 //
-//      This constructor does not initialize the bitmap from a disk file
+//      This constructor does not initialize the bitmap from a disk file,
+//	so every sector is considered dirty -- the first WriteBack
+//	writes out the whole map.
 //----------------------------------------------------------------------
 
 PersistentBitmap::PersistentBitmap(int numItems) : Bitmap(numItems)
 {
+    numFileSectors = divRoundUp(numWords * sizeof(unsigned), SectorSize);
+    dirty = new bool[numFileSectors];
+    for (int i = 0; i < numFileSectors; i++)
+        dirty[i] = TRUE;
+    numDirty = numFileSectors;
+    goal = 0;
 }
 
 //----------------------------------------------------------------------
@@ -37,10 +52,14 @@ PersistentBitmap::PersistentBitmap(int numItems) : Bitmap(numItems)
 
 PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems) : Bitmap(numItems)
 {
+    numFileSectors = divRoundUp(numWords * sizeof(unsigned), SectorSize);
+    dirty = new bool[numFileSectors];
+
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
-    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    FetchFrom(file);
+    goal = 0;
 }
 
 //----------------------------------------------------------------------
@@ -50,6 +69,58 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems) : Bitmap(numIte
 
 PersistentBitmap::~PersistentBitmap()
 {
+    delete[] dirty;
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::Mark/Clear
+// 	Set or clear the "nth" bit, remembering that the sector of the
+//	bitmap file holding it has to be written back.
+//
+//	"which" is the number of the bit to be set/cleared.
+//----------------------------------------------------------------------
+
+void PersistentBitmap::Mark(int which)
+{
+    Bitmap::Mark(which);
+    MarkDirty(which);
+}
+
+void PersistentBitmap::Clear(int which)
+{
+    Bitmap::Clear(which);
+    MarkDirty(which);
+}
+
+void PersistentBitmap::MarkDirty(int which)
+{
+    int sector = (which / BitsInWord) * sizeof(unsigned) / SectorSize;
+
+    if (!dirty[sector])
+    {
+        dirty[sector] = TRUE;
+        numDirty++;
+    }
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::FindAndSet
+// 	Allocate a sector as close after the goal as possible (cf.
+//	FileSystem::Create, which sets the goal to keep a directory's
+//	files together on disk).  The goal then moves just past the
+//	sector we return, so a file's header, index blocks and data
+//	are laid out one after another.
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int PersistentBitmap::FindAndSet()
+{
+    int which = FindAndSetFrom(goal);
+
+    if (which >= 0)
+        goal = which + 1;
+    return which;
 }
 
 //----------------------------------------------------------------------
@@ -62,16 +133,64 @@ PersistentBitmap::~PersistentBitmap()
 void PersistentBitmap::FetchFrom(OpenFile *file)
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    for (int i = 0; i < numFileSectors; i++)
+        dirty[i] = FALSE;
+    numDirty = 0;
 }
 
 //----------------------------------------------------------------------
 // PersistentBitmap::WriteBack
-// 	Store the contents of a persistent bitmap to a Nachos file.
+// 	Store the modified parts of a persistent bitmap to a Nachos file.
+//	Runs of adjacent dirty sectors are written with a single WriteAt.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
 
 void PersistentBitmap::WriteBack(OpenFile *file)
 {
-    file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int mapBytes = numWords * sizeof(unsigned);
+    int first, last;
+
+    for (first = 0; first < numFileSectors && numDirty > 0; first = last)
+    {
+        if (!dirty[first])
+        {
+            last = first + 1;
+            continue;
+        }
+        for (last = first; last < numFileSectors && dirty[last]; last++)
+        {
+            dirty[last] = FALSE;
+            numDirty--;
+        }
+        int position = first * SectorSize;
+        int numBytes = min(last * SectorSize, mapBytes) - position;
+        file->WriteAt((char *)map + position, numBytes, position);
+    }
+    ASSERT(numDirty == 0);
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::Revert
+// 	Discard every change made since the last FetchFrom/WriteBack, by
+//	re-reading just the dirty sectors from the Nachos file.  Used
+//	when an operation fails half way through allocating.
+//
+//	"file" is the place the bitmap was last read from/written to
+//----------------------------------------------------------------------
+
+void PersistentBitmap::Revert(OpenFile *file)
+{
+    int mapBytes = numWords * sizeof(unsigned);
+
+    for (int i = 0; i < numFileSectors && numDirty > 0; i++)
+    {
+        if (!dirty[i])
+            continue;
+        int position = i * SectorSize;
+        file->ReadAt((char *)map + position,
+                     min(position + SectorSize, mapBytes) - position, position);
+        dirty[i] = FALSE;
+        numDirty--;
+    }
 }
@@ -6,6 +6,11 @@
 //    when it is created, or it can be initialized later using
 //    the FetchFrom method
 //
+//    The bitmap remembers which sectors of its backing file have
+//    been modified since the last FetchFrom/WriteBack, so that
+//    WriteBack only has to write those sectors, and Revert only
+//    has to re-read them.
+//
 // Copyright (c) 1992,1993,1995 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
@@ -29,8 +34,30 @@ public:
 
     ~PersistentBitmap(); // deallocate bitmap
 
+    void Mark(int which);  // Set/clear the "nth" bit, and
+    void Clear(int which); //  remember the sector it lives in
+
+    void SetGoal(int which) { goal = which; } // Allocate near "which"
+    int FindAndSet(); // Allocate the first clear bit at or
+                      //  after the goal; the goal moves past it,
+                      //  so successive sectors are contiguous
+
     void FetchFrom(OpenFile *file); // read bitmap from the disk
-    void WriteBack(OpenFile *file); // write bitmap contents to disk
+    void WriteBack(OpenFile *file); // write modified sectors of the
+                                    //  bitmap contents to disk
+    void Revert(OpenFile *file);    // throw away changes made since
+                                    //  the last FetchFrom/WriteBack
+
+    bool IsDirty() const { return numDirty > 0; }
+
+private:
+    int numFileSectors; // # of disk sectors the bitmap occupies
+    bool *dirty;        // dirty[i] is TRUE if sector i of the bitmap
+                        //  file differs from the copy in memory
+    int numDirty;       // # of entries in "dirty" that are TRUE
+    int goal;           // where the next FindAndSet starts looking
+
+    void MarkDirty(int which); // note the sector holding bit "which"
 };
 
 #endif // PBITMAP_H
@@ -0,0 +1,177 @@
+// rangelock.cc
+//	Routines to lock byte ranges of an open file.
+//
+//	The locks of the open files are kept on one list, searched by
+//	header sector.  Nachos threads are only switched at well-defined
+//	points (none of which occur in Open, Close or Unlink), so the list
+//	needs no lock of its own.
+//
+//	A file has few ranges locked at once, so the held ranges are a
+//	plain list, linked through the callers' own LockedRanges, and a
+//	waiter rechecks the whole list every time a range is released.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "rangelock.h"
+
+// The locks of all open files
+static List<RangeLock *> *openLocks = NULL;
+
+//----------------------------------------------------------------------
+// RangeLock::Open
+// 	Return the range lock of the file whose header is in "hdrSector",
+//	creating it if the file is not open yet.  Every Open must be
+//	matched by a Close.
+//----------------------------------------------------------------------
+
+RangeLock *RangeLock::Open(int hdrSector)
+{
+    RangeLock *rl = NULL;
+
+    if (openLocks == NULL)
+        openLocks = new List<RangeLock *>;
+    ListIterator<RangeLock *> it(openLocks);
+    for (; !it.IsDone(); it.Next())
+        if (it.Item()->hdrSector == hdrSector)
+        {
+            rl = it.Item();
+            break;
+        }
+    if (rl == NULL)
+    {
+        rl = new RangeLock(hdrSector);
+        openLocks->Append(rl);
+    }
+    rl->numOpens++;
+    return rl;
+}
+
+//----------------------------------------------------------------------
+// RangeLock::Close
+// 	Drop one reference to "rl"; the last one de-allocates it.
+//
+//	Return TRUE if that was the last reference, and the file has been
+//	removed meanwhile -- then the caller must see that its space is
+//	freed (cf. Reaper::Closed).
+//----------------------------------------------------------------------
+
+bool RangeLock::Close(RangeLock *rl)
+{
+    bool unlinked = rl->unlinked;
+
+    ASSERT(rl->numOpens > 0);
+    if (--rl->numOpens > 0)
+        return FALSE;
+    ASSERT(rl->held == NULL);
+    openLocks->Remove(rl);
+    delete rl;
+    return unlinked;
+}
+
+//----------------------------------------------------------------------
+// RangeLock::Unlink
+// 	Note that the file with header "hdrSector" has lost its name.
+//	Return FALSE if it is not open, so it can be freed right away.
+//----------------------------------------------------------------------
+
+bool RangeLock::Unlink(int hdrSector)
+{
+    if (openLocks == NULL)
+        return FALSE;
+    ListIterator<RangeLock *> it(openLocks);
+    for (; !it.IsDone(); it.Next())
+        if (it.Item()->hdrSector == hdrSector)
+        {
+            it.Item()->unlinked = TRUE;
+            return TRUE;
+        }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// RangeLock::RangeLock
+// 	Initialize the lock of one file, with nothing locked.
+//----------------------------------------------------------------------
+
+RangeLock::RangeLock(int hdrSector)
+{
+    this->hdrSector = hdrSector;
+    numOpens = 0;
+    unlinked = FALSE;
+    lock = new Lock("range lock");
+    changed = new Condition("range released");
+    held = NULL;
+}
+
+RangeLock::~RangeLock()
+{
+    delete lock;
+    delete changed;
+}
+
+//----------------------------------------------------------------------
+// RangeLock::Acquire
+// 	Lock the sectors holding "numBytes" bytes at "position", shared
+//	or "exclusive".  Wait while someone else holds an overlapping
+//	range, if either of us wants it exclusive.
+//
+//	"range" is filled in, and must be handed back to Release; it
+//	must stay put until then.
+//----------------------------------------------------------------------
+
+void RangeLock::Acquire(LockedRange *range, FileOffset position, int numBytes,
+                        bool exclusive)
+{
+    range->start = divRoundDown(position, SectorSize) * SectorSize;
+    range->end = divRoundUp(position + max(numBytes, 1), SectorSize) * SectorSize;
+    range->exclusive = exclusive;
+
+    lock->Acquire();
+    while (Conflicts(range))
+    {
+        DEBUG(dbgFile, "Waiting for bytes " << range->start << "-"
+                                            << range->end << " of file " << hdrSector);
+        changed->Wait(lock);
+    }
+    range->next = held;
+    held = range;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RangeLock::Release
+// 	Unlock "range", and let any waiters check again.
+//----------------------------------------------------------------------
+
+void RangeLock::Release(LockedRange *range)
+{
+    LockedRange **p;
+
+    lock->Acquire();
+    for (p = &held; *p != range; p = &(*p)->next)
+        ASSERT(*p != NULL);
+    *p = range->next;
+    changed->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RangeLock::Conflicts
+// 	Return TRUE if a held range overlaps "range", and one of the two
+//	is exclusive.
+//----------------------------------------------------------------------
+
+bool RangeLock::Conflicts(LockedRange *range)
+{
+    for (LockedRange *other = held; other != NULL; other = other->next)
+    {
+        if (other->start < range->end && range->start < other->end &&
+            (other->exclusive || range->exclusive))
+            return TRUE;
+    }
+    return FALSE;
+}
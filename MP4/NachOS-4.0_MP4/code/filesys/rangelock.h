@@ -0,0 +1,79 @@
+// rangelock.h
+//	Data structures for locking byte ranges of a file.
+//
+//	Every file that is open has one RangeLock, shared by all of the
+//	OpenFile objects for it (and found through the sector holding
+//	its header).  A reader locks the range it reads in shared mode,
+//	a writer in exclusive mode; a request waits only for ranges that
+//	overlap it and are held in a conflicting mode.  So any number of
+//	readers, and writers to different parts of the file, proceed
+//	together.
+//
+//	Ranges are rounded out to whole sectors, since a write to part of
+//	a sector reads and writes back all of it: two writes to different
+//	bytes of one sector must not run at the same time.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef RANGELOCK_H
+#define RANGELOCK_H
+
+#include "disk.h"
+#include "list.h"
+#include "synch.h"
+
+// A range of a file locked by some thread.  It belongs to the caller
+// (usually it is on the caller's stack), so that locking a range does
+// not allocate memory; while it is held, it is linked into the list of
+// held ranges through "next".
+
+class LockedRange
+{
+public:
+    FileOffset start;   // first byte (a multiple of SectorSize)
+    FileOffset end;     // first byte after the range (ditto)
+    bool exclusive;     // held for writing?
+    LockedRange *next;  // next held range of the same file
+};
+
+// The following class defines the range lock of one open file.
+
+class RangeLock
+{
+public:
+    static RangeLock *Open(int hdrSector); // The lock of the file with
+                                           //  header "hdrSector", created
+                                           //  by its first OpenFile
+    static bool Close(RangeLock *rl);      // One of its OpenFiles is gone;
+                                           //  TRUE if it was the last one
+                                           //  of a file already removed
+    static bool Unlink(int hdrSector);     // The file was removed; FALSE
+                                           //  if it is not open
+
+    void Acquire(LockedRange *range, FileOffset position, int numBytes,
+                 bool exclusive);
+    // Wait until no one else holds an
+    //  overlapping range in a conflicting
+    //  mode, then lock this one, recording
+    //  it in "range"
+    void Release(LockedRange *range); // Unlock a range from Acquire
+
+private:
+    RangeLock(int hdrSector);
+    ~RangeLock();
+
+    int hdrSector;              // which file this is
+    int numOpens;               // # of OpenFiles sharing it
+    bool unlinked;              // has the file been removed?
+    Lock *lock;                 // protects "held"
+    Condition *changed;         // signalled when a range is released
+    LockedRange *held;          // ranges locked now
+
+    bool Conflicts(LockedRange *range); // lock must be held
+};
+
+#endif // RANGELOCK_H
@@ -0,0 +1,236 @@
+// reaper.cc
+//	Routines to free the space of removed files in the background.
+//
+//	Files and directories waiting to be freed are kept on two queues.
+//	Unlinked and Closed add to them and wake the reaper thread; they
+//	never wait for anything but the queue lock, so they may be called
+//	from inside a journal transaction.  Drain empties the queues, one
+//	batch per call: the whole tree under a directory is read with a
+//	TreeWalk (a level at a time, in sector order), and everything
+//	in it is freed, except files that are open -- those are only
+//	marked, and freed when they are closed.  Each tree's headers are
+//	freed in sector order, and the whole batch is one transaction.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "synchdisk.h"
+#include "filehdr.h"
+#include "directory.h"
+#include "pbitmap.h"
+#include "journal.h"
+#include "delayed.h"
+#include "rangelock.h"
+#include "reaper.h"
+#include "treewalk.h"
+
+//----------------------------------------------------------------------
+// CompareSectors
+// 	Order header sectors by where they are on disk, for qsort.
+//----------------------------------------------------------------------
+
+static int
+CompareSectors(const void *a, const void *b)
+{
+    return *(int *)a - *(int *)b;
+}
+
+//----------------------------------------------------------------------
+// ReaperThread
+// 	Entry point of the reaper thread.
+//----------------------------------------------------------------------
+
+static void
+ReaperThread(void *arg)
+{
+    ((Reaper *)arg)->Run();
+}
+
+//----------------------------------------------------------------------
+// Reaper::Reaper
+// 	Initialize empty queues, and start the reaper thread.
+//
+//	"freeMap" -- the in-memory free map
+//	"freeMapFile" -- the file holding the free map on disk
+//	"journal" -- the file system's metadata journal
+//----------------------------------------------------------------------
+
+Reaper::Reaper(PersistentBitmap *freeMap, OpenFile *freeMapFile, Journal *journal)
+{
+    this->freeMap = freeMap;
+    this->freeMapFile = freeMapFile;
+    this->journal = journal;
+    queueLock = new Lock("reaper queue");
+    files = new List<int>;
+    dirs = new List<int>;
+    drainLock = new Lock("reaper");
+    workToDo = new Semaphore("reaper work", 0);
+
+    Thread *t = new Thread("reaper", -1);
+    t->Fork((VoidFunctionPtr)ReaperThread, (void *)this);
+}
+
+//----------------------------------------------------------------------
+// Reaper::~Reaper
+// 	De-allocate the queues.  Anything still on them is leaked on
+//	disk, so the file system drains them first.
+//----------------------------------------------------------------------
+
+Reaper::~Reaper()
+{
+    delete queueLock;
+    delete files;
+    delete dirs;
+    delete drainLock;
+    delete workToDo;
+}
+
+//----------------------------------------------------------------------
+// Reaper::Unlinked
+// 	The directory entry naming "sector" has been removed.  Queue a
+//	directory for freeing; a file too, unless it is open -- then it
+//	is queued by Closed, when its last OpenFile goes away.
+//----------------------------------------------------------------------
+
+void Reaper::Unlinked(int sector, bool isDir)
+{
+    queueLock->Acquire();
+    if (isDir || !RangeLock::Unlink(sector))
+        Queue(sector, isDir);
+    queueLock->Release();
+}
+
+//----------------------------------------------------------------------
+// Reaper::Closed
+// 	The last OpenFile of the unlinked file "sector" was deleted.
+//----------------------------------------------------------------------
+
+void Reaper::Closed(int sector)
+{
+    queueLock->Acquire();
+    Queue(sector, FALSE);
+    queueLock->Release();
+}
+
+//----------------------------------------------------------------------
+// Reaper::Drain
+// 	Free every file and directory on the queues, including the
+//	contents of the directories, in one journal transaction.  The
+//	root of each walk is node 0, a directory, so it is always freed.
+//----------------------------------------------------------------------
+
+void Reaper::Drain()
+{
+    int sector, numFreed = 0;
+    bool isDir;
+
+    drainLock->Acquire();
+    if (files->IsEmpty() && dirs->IsEmpty())
+    {
+        drainLock->Release();
+        return;
+    }
+    journal->Begin();
+    for (;;)
+    {
+        queueLock->Acquire();
+        sector = -1;
+        if (!dirs->IsEmpty())
+        {
+            sector = dirs->RemoveFront();
+            isDir = TRUE;
+        }
+        else if (!files->IsEmpty())
+        {
+            sector = files->RemoveFront();
+            isDir = FALSE;
+        }
+        queueLock->Release();
+        if (sector < 0)
+            break;
+
+        if (!isDir)
+        {
+            Free(sector);
+            numFreed++;
+            continue;
+        }
+
+        TreeWalk *walk = new TreeWalk(sector);
+        int *order, numOrder = 0;
+
+        walk->Run();
+        order = new int[walk->NumNodes()];
+        for (int i = 0; i < walk->NumNodes(); i++)
+        {
+            WalkNode *node = walk->Node(i);
+
+            if (!node->isDir && RangeLock::Unlink(node->sector))
+                continue; // open: freed when closed
+            order[numOrder++] = node->sector;
+        }
+        qsort(order, numOrder, sizeof(int), CompareSectors);
+        for (int i = 0; i < numOrder; i++)
+            Free(order[i]);
+        numFreed += numOrder;
+        delete[] order;
+        delete walk;
+    }
+    DEBUG(dbgFile, "Reaper freed " << numFreed << " files and directories.");
+    freeMap->WriteBack(freeMapFile);
+    journal->End();
+    drainLock->Release();
+}
+
+//----------------------------------------------------------------------
+// Reaper::Run
+// 	Body of the reaper thread: wait for work, drain the queues,
+//	repeat.
+//----------------------------------------------------------------------
+
+void Reaper::Run()
+{
+    for (;;)
+    {
+        workToDo->P();
+        Drain();
+    }
+}
+
+//----------------------------------------------------------------------
+// Reaper::Queue
+// 	Add "sector" to the right queue, and wake the reaper.
+//----------------------------------------------------------------------
+
+void Reaper::Queue(int sector, bool isDir)
+{
+    if (isDir)
+        dirs->Append(sector);
+    else
+        files->Append(sector);
+    workToDo->V();
+}
+
+//----------------------------------------------------------------------
+// Reaper::Free
+// 	Give the header in "sector", and the data and index sectors it
+//	points to, back to the free map.  Data still waiting for its
+//	sectors (in write-back mode) is simply dropped.
+//----------------------------------------------------------------------
+
+void Reaper::Free(int sector)
+{
+    DelayedWrites *delayed = kernel->synchDisk->GetDelayed();
+    FileHeader *hdr = new FileHeader;
+
+    if (delayed != NULL)
+        delayed->Discard(sector);
+    hdr->FetchFrom(sector);
+    hdr->Deallocate(freeMap);
+    freeMap->Clear(sector);
+    delete hdr;
+}
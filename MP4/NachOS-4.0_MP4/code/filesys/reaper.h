@@ -0,0 +1,72 @@
+// reaper.h
+//	Data structures for reclaiming the space of removed files in the
+//	background.
+//
+//	As in UNIX, removing a file only removes its name: the directory
+//	entry goes at once, but the header and data sectors are freed
+//	only once the file is no longer open anywhere.  Removing a
+//	directory tree likewise just unlinks the top of it.
+//
+//	Freeing is left to the reaper, a kernel thread that takes every
+//	file and directory waiting to be reclaimed and frees them all in
+//	a single journal transaction -- walking the directories it finds
+//	to queue their contents -- so that the thread calling Remove
+//	doesn't wait for a big file or tree to be taken apart.
+//
+//	A crash before the reaper gets to a file leaks its sectors; they
+//	are found, and given back, by "nachos -fsckr".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef REAPER_H
+#define REAPER_H
+
+#include "list.h"
+#include "synch.h"
+
+class PersistentBitmap;
+class OpenFile;
+class Journal;
+
+// The following class defines the reaper.  It is created by the file
+// system, which hands it the free map and the journal.
+
+class Reaper
+{
+public:
+    Reaper(PersistentBitmap *freeMap, OpenFile *freeMapFile, Journal *journal);
+    // Start the reaper thread
+    ~Reaper();
+
+    void Unlinked(int sector, bool isDir);
+    // The name of the file (or directory
+    //  tree) with header "sector" is gone;
+    //  free it once no one has it open
+    void Closed(int sector); // An unlinked file's last OpenFile is gone
+
+    void Drain(); // Free everything waiting, now, in the
+                  //  calling thread (for Sync and Halt)
+
+    void Run(); // Body of the reaper thread
+
+private:
+    PersistentBitmap *freeMap; // where sectors go back to
+    OpenFile *freeMapFile;     // where the free map is written back
+    Journal *journal;          // makes each batch atomic
+
+    Lock *queueLock;           // protects the queues
+    List<int> *files;          // headers of files to free
+    List<int> *dirs;           // headers of directories to free,
+                               //  contents and all
+    Lock *drainLock;           // one batch at a time
+    Semaphore *workToDo;       // the reaper waits on this
+
+    void Queue(int sector, bool isDir); // queueLock must be held
+    void Free(int sector);              // free one header and its data
+};
+
+#endif // REAPER_H
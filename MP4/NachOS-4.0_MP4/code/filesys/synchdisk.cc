@@ -10,31 +10,80 @@
 //	handle one operation at a time, use a lock to enforce mutual
 //	exclusion.
 //
+//	On top of that sits a cache of recently used sectors, managed
+//	LRU.  Every read and write goes through it, so the cache never
+//	holds a copy older than the disk's.  (A sector the journal has a
+//	newer copy of is read from the journal instead.)  In write-back
+//	mode, writes only dirty the cached copy; the flusher thread
+//	writes dirty sectors to disk, sorted by sector number, every
+//	FlushInterval timer interrupts, when Sync is called, and before
+//	Nachos runs out of threads to run.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
+#include "delayed.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// FlusherThread
+// 	Entry point of the background flusher thread.
+//----------------------------------------------------------------------
+
+static void
+FlusherThread(void *arg)
+{
+    ((SynchDisk *)arg)->Flusher();
+}
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"writeBack" -- if TRUE, delay writes in the cache and start a
+//		thread to write them back
+//	"numSectors" -- how big to make the disk, or 0 to leave it
+//		the size it is
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk()
+SynchDisk::SynchDisk(bool writeBack, int numSectors)
 {
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
-    disk = new Disk(this);
+    disk = new Disk(this, numSectors);
+    journal = NULL;
+    delayed = NULL;
+
+    cache = new CacheEntry[NumCacheSectors];
+    for (int i = 0; i < NumCacheSectors; i++)
+    {
+        cache[i].sector = -1;
+        cache[i].dirty = FALSE;
+        cache[i].lastUsed = 0;
+    }
+    useCounter = 0;
+    numDirty = 0;
+    ticks = 0;
+    flusherIdle = FALSE;
+    flushNeeded = new Semaphore("disk flush", 0);
+
+    this->writeBack = writeBack;
+    if (writeBack)
+    {
+        Thread *t = new Thread("disk flusher", -1);
+        t->Fork((VoidFunctionPtr)FlusherThread, (void *)this);
+    }
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  Dirty sectors must have been flushed by now.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
@@ -42,6 +91,8 @@ SynchDisk::~SynchDisk()
     delete disk;
     delete lock;
     delete semaphore;
+    delete flushNeeded;
+    delete[] cache;
 }
 
 //----------------------------------------------------------------------
@@ -49,22 +100,44 @@ SynchDisk::~SynchDisk()
 // 	Read the contents of a disk sector into a buffer.  Return only
 //	after the data has been read.
 //
+//	If the journal has a newer copy of the sector than the disk
+//	(written by a transaction that hasn't been checkpointed), we
+//	return that instead.  Otherwise the cache is checked before
+//	going to the disk.
+//
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
 //----------------------------------------------------------------------
 
 void SynchDisk::ReadSector(int sectorNumber, char *data)
 {
+    CacheEntry *e;
+
+    if (journal != NULL && journal->Lookup(sectorNumber, data))
+        return;
     lock->Acquire(); // only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P(); // wait for interrupt
+    e = FindSector(sectorNumber);
+    if (e == NULL)
+    {
+        e = AllocSector(sectorNumber);
+        DiskRead(sectorNumber, e->data);
+    }
+    bcopy(e->data, data, SectorSize);
     lock->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
 // 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+//	after the data has been written -- or, in write-back mode, once
+//	it is in the cache.
+//
+//	Inside a journal transaction, the journal keeps the sector
+//	instead, and writes it to the log when the transaction commits.
+//	A cached copy is left as it was, dirty or not: reads find the
+//	journal's copy first, the checkpoint refreshes the cache when it
+//	writes the sector home, and if the transaction is aborted the
+//	cached copy is the right one again.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -72,10 +145,224 @@ void SynchDisk::ReadSector(int sectorNumber, char *data)
 
 void SynchDisk::WriteSector(int sectorNumber, char *data)
 {
+    CacheEntry *e;
+
+    if (journal != NULL && journal->Absorb(sectorNumber, data))
+        return;
+
     lock->Acquire(); // only one disk I/O at a time
+    e = FindSector(sectorNumber);
+    if (e == NULL)
+        e = AllocSector(sectorNumber);
+    bcopy(data, e->data, SectorSize);
+    if (writeBack)
+    {
+        if (!e->dirty)
+        {
+            e->dirty = TRUE;
+            numDirty++;
+        }
+    }
+    else
+        DiskWrite(sectorNumber, data);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteThrough
+// 	Write a sector to disk before returning, even in write-back
+//	mode, and without consulting the journal.  The journal uses
+//	this for the log and for checkpoints, whose writes must reach
+//	the disk in the order they are made.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
+void SynchDisk::WriteThrough(int sectorNumber, char *data)
+{
+    CacheEntry *e;
+
+    lock->Acquire();
+    e = FindSector(sectorNumber);
+    if (e != NULL)
+    {
+        bcopy(data, e->data, SectorSize);
+        if (e->dirty)
+        {
+            e->dirty = FALSE;
+            numDirty--;
+        }
+    }
+    DiskWrite(sectorNumber, data);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Give sectors to any writes still waiting for them, commit any
+//	finished journal transactions, then write every dirty sector in
+//	the cache to disk, in increasing sector order so that the disk
+//	head sweeps across once.
+//
+//	Return FALSE if the waiting writes could not be given sectors
+//	(the disk filled up anyway); they are still waiting, and are
+//	tried again at the next flush.  Everything else is flushed.
+//----------------------------------------------------------------------
+
+bool SynchDisk::Flush()
+{
+    int order[NumCacheSectors];
+    int numOrder = 0;
+    bool placed = TRUE;
+
+    if (delayed != NULL)
+        placed = delayed->Place();
+    if (journal != NULL)
+        journal->Commit();
+
+    lock->Acquire();
+    for (int i = 0; i < NumCacheSectors; i++)
+    {
+        if (!cache[i].dirty)
+            continue;
+        int j = numOrder++;
+        while (j > 0 && cache[order[j - 1]].sector > cache[i].sector)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    if (numOrder > 0)
+    {
+        DEBUG(dbgDisk, "Flushing " << numOrder << " dirty sectors.");
+    }
+    for (int i = 0; i < numOrder; i++)
+    {
+        CacheEntry *e = &cache[order[i]];
+        e->dirty = FALSE;
+        numDirty--;
+        DiskWrite(e->sector, e->data);
+    }
+    lock->Release();
+    return placed;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::TimerTick
+// 	Called from the timer interrupt handler, with interrupts
+//	disabled.  Every FlushInterval ticks, wake up the flusher.
+//----------------------------------------------------------------------
+
+void SynchDisk::TimerTick()
+{
+    if (writeBack && ++ticks >= FlushInterval)
+    {
+        ticks = 0;
+        WakeFlusher();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WakeFlusher
+// 	If the flusher thread is waiting for work and there is dirty
+//	data in the cache, a write waiting to be placed, or a finished
+//	transaction in the journal, put it on the ready list.
+//	Thread::Sleep calls this before letting the machine go idle, so
+//	delayed writes reach the disk before Nachos halts.
+//
+//	Returns TRUE if the flusher was woken.
+//----------------------------------------------------------------------
+
+bool SynchDisk::WakeFlusher()
+{
+    if (!flusherIdle)
+        return FALSE;
+    if (numDirty == 0 && (journal == NULL || !journal->HasPending()) &&
+        (delayed == NULL || !delayed->HasPending()))
+        return FALSE;
+    flusherIdle = FALSE;
+    flushNeeded->V();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flusher
+// 	Body of the flusher thread: wait to be woken, flush, repeat.
+//	Delayed writes that find no room stay buffered; Sync and Halt
+//	report them.
+//----------------------------------------------------------------------
+
+void SynchDisk::Flusher()
+{
+    for (;;)
+    {
+        flusherIdle = TRUE;
+        flushNeeded->P();
+        Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::DiskRead/DiskWrite
+// 	Send a request to the raw disk, and wait for it to finish.
+//	The caller must hold the lock.
+//----------------------------------------------------------------------
+
+void SynchDisk::DiskRead(int sectorNumber, char *data)
+{
+    disk->ReadRequest(sectorNumber, data);
+    semaphore->P(); // wait for interrupt
+}
+
+void SynchDisk::DiskWrite(int sectorNumber, char *data)
+{
     disk->WriteRequest(sectorNumber, data);
     semaphore->P(); // wait for interrupt
-    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FindSector
+// 	Return the cache entry holding "sectorNumber", or NULL.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::FindSector(int sectorNumber)
+{
+    for (int i = 0; i < NumCacheSectors; i++)
+        if (cache[i].sector == sectorNumber)
+        {
+            cache[i].lastUsed = ++useCounter;
+            return &cache[i];
+        }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::AllocSector
+// 	Find a cache entry for "sectorNumber", which is not cached:
+//	the least recently used one.  If it is dirty, write it back
+//	first.  The caller fills in the data.
+//----------------------------------------------------------------------
+
+CacheEntry *
+SynchDisk::AllocSector(int sectorNumber)
+{
+    CacheEntry *e = &cache[0];
+
+    for (int i = 1; i < NumCacheSectors; i++)
+        if (cache[i].lastUsed < e->lastUsed)
+            e = &cache[i];
+    if (e->dirty)
+    {
+        e->dirty = FALSE;
+        numDirty--;
+        DiskWrite(e->sector, e->data);
+    }
+    e->sector = sectorNumber;
+    e->lastUsed = ++useCounter;
+    return e;
 }
 
 //----------------------------------------------------------------------
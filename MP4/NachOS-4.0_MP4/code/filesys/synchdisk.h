@@ -15,6 +15,9 @@
 #include "synch.h"
 #include "callback.h"
 
+class Journal;
+class DelayedWrites;
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -25,12 +28,40 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// The synchronous disk also keeps a small cache of recently used
+// sectors.  In write-back mode, WriteSector just updates the cached
+// copy and returns; a background flusher thread, woken every
+// FlushInterval timer interrupts (and by Sync), writes the dirty
+// sectors out in increasing sector order, so that many small writes
+// to the same sector cost a single disk write.
+
+// # of sectors kept in the cache
+const int NumCacheSectors = 64;
+
+// # of timer interrupts between background flushes
+const int FlushInterval = 10;
+
+// A cached copy of one disk sector.
+
+class CacheEntry
+{
+public:
+    int sector;            // which sector this is a copy of, or -1
+    bool dirty;            // newer than the copy on disk?
+    int lastUsed;          // for LRU replacement
+    char data[SectorSize]; // the contents of the sector
+};
 
 class SynchDisk : public CallBackObj
 {
 public:
-    SynchDisk();  // Initialize a synchronous disk,
-                  // by initializing the raw Disk.
+    SynchDisk(bool writeBack, int numSectors);
+    // Initialize a synchronous disk,
+    // by initializing the raw Disk.
+    // If "writeBack", delay writes
+    // and start the flusher thread;
+    // "numSectors" is as for Disk
     ~SynchDisk(); // De-allocate the synch disk data
 
     void ReadSector(int sectorNumber, char *data);
@@ -41,16 +72,66 @@ public:
     // then wait until the request is done.
     void WriteSector(int sectorNumber, char *data);
 
+    int NumSectors() { return disk->NumSectors(); }
+    // How big the disk is
+
+    void WriteThrough(int sectorNumber, char *data);
+    // Write a sector to disk now, bypassing
+    // the journal and write-back (used by
+    // the journal for its own I/O)
+
+    bool Flush();       // Place delayed writes, commit finished
+                        // journal transactions, and write every
+                        // dirty sector to disk.  FALSE if the
+                        // delayed writes found no room
+    void TimerTick();   // Called on each timer interrupt;
+                        // wakes the flusher now and then
+    bool WakeFlusher(); // Wake the flusher if it is idle and
+                        // there is something to write.  Return
+                        // TRUE if it was woken
+    bool IsWriteBack() { return writeBack; }
+
+    void Flusher(); // Body of the flusher thread
+
     void CallBack(); // Called by the disk device interrupt
                      // handler, to signal that the
                      // current disk operation is complete.
 
+    void SetJournal(Journal *j) { journal = j; }
+                     // Route reads and writes through the
+                     // file system's metadata journal
+    Journal *GetJournal() { return journal; }
+                     // The journal, or NULL before there is one
+    void SetDelayed(DelayedWrites *d) { delayed = d; }
+                     // Place these buffered writes before
+                     // each flush
+    DelayedWrites *GetDelayed() { return delayed; }
+                     // The buffered writes, or NULL if
+                     // data is allocated as it is written
+
 private:
     Disk *disk;           // Raw disk device
     Semaphore *semaphore; // To synchronize requesting thread
                           // with the interrupt handler
     Lock *lock;           // Only one read/write request
                           // can be sent to the disk at a time
+    Journal *journal;     // Captures writes made inside a
+                          // transaction, if non-NULL
+    DelayedWrites *delayed; // Writes to holes, waiting for
+                          // sectors, if non-NULL
+
+    CacheEntry *cache;    // recently used sectors
+    int useCounter;       // # of cache accesses, for LRU
+    int numDirty;         // # of dirty cache entries
+    bool writeBack;       // delay writes until the next flush?
+    int ticks;            // timer interrupts since the last flush
+    bool flusherIdle;     // is the flusher waiting for work?
+    Semaphore *flushNeeded; // the flusher waits on this
+
+    void DiskRead(int sectorNumber, char *data);  // the raw disk I/O;
+    void DiskWrite(int sectorNumber, char *data); //  lock must be held
+    CacheEntry *FindSector(int sectorNumber);     // cached copy, or NULL
+    CacheEntry *AllocSector(int sectorNumber);    // make room for a sector
 };
 
 #endif // SYNCHDISK_H
@@ -0,0 +1,138 @@
+// treewalk.cc
+//	Routines to read a directory tree breadth first, one wave of
+//	directories at a time, each wave in sector order.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "main.h"
+#include "openfile.h"
+#include "treewalk.h"
+#include "wave.h"
+
+//----------------------------------------------------------------------
+// TreeWalk::TreeWalk
+// 	Set up a walk of the tree under the directory whose header is
+//	in "rootSector".  Nothing is read until Run.
+//----------------------------------------------------------------------
+
+TreeWalk::TreeWalk(int rootSector)
+{
+    maxNodes = NumDirEntries;
+    nodes = new WalkNode[maxNodes];
+    numNodes = 0;
+    AddNode(rootSector, TRUE, -1, (char *)"");
+}
+
+//----------------------------------------------------------------------
+// TreeWalk::~TreeWalk
+// 	De-allocate what the walk found.
+//----------------------------------------------------------------------
+
+TreeWalk::~TreeWalk()
+{
+    delete[] nodes;
+}
+
+//----------------------------------------------------------------------
+// TreeWalk::Run
+// 	Read the tree, one depth at a time.  Each wave holds the
+//	directories found at one depth; reading one adds its entries as
+//	nodes, and queues the directories among them for the next wave.
+//----------------------------------------------------------------------
+
+void TreeWalk::Run()
+{
+    WaveQueue *waves = new WaveQueue();
+    int numWaves = 0;
+
+    waves->Queue(nodes[0].sector, 0, 0, 0, -1);
+    while (waves->NextWave())
+    {
+        for (int k = 0; k < waves->Size(); k++)
+        {
+            int parent = waves->Item(k)->node;
+            OpenFile *file = new OpenFile(nodes[parent].sector);
+            Directory *dir = new Directory(NumDirEntries);
+
+            dir->FetchFrom(file);
+            delete file;
+
+            nodes[parent].firstChild = numNodes;
+            for (int e = 0; e < NumDirEntries; e++)
+            {
+                bool isDir;
+                int sector = dir->EntrySector(e, &isDir);
+
+                if (sector < 0)
+                    continue;
+                int child = AddNode(sector, isDir, nodes[parent].depth + 1,
+                                    dir->EntryName(e));
+                nodes[parent].numChildren++;
+                if (isDir)
+                    waves->Queue(sector, 0, child, 0, -1);
+            }
+            delete dir;
+        }
+        numWaves++;
+    }
+    delete waves;
+    DEBUG(dbgFile, "Tree walk found " << numNodes - 1 << " entries in "
+                                      << numWaves << " waves.");
+}
+
+//----------------------------------------------------------------------
+// TreeWalk::List
+// 	Print every file and directory found, each directory followed
+//	by its contents, indented one space per level.
+//----------------------------------------------------------------------
+
+void TreeWalk::List()
+{
+    ListChildren(0);
+}
+
+void TreeWalk::ListChildren(int node)
+{
+    for (int i = 0; i < nodes[node].numChildren; i++)
+    {
+        int child = nodes[node].firstChild + i;
+
+        for (int d = 0; d < nodes[child].depth; d++)
+            printf(" ");
+        printf("%s%s\n", nodes[child].isDir ? "{D}: " : "{F}: ",
+               nodes[child].name);
+        if (nodes[child].isDir)
+            ListChildren(child);
+    }
+}
+
+//----------------------------------------------------------------------
+// TreeWalk::AddNode
+// 	Add a node to the table, growing it if need be; return its index.
+//----------------------------------------------------------------------
+
+int TreeWalk::AddNode(int sector, bool isDir, int depth, char *name)
+{
+    if (numNodes == maxNodes)
+    {
+        WalkNode *bigger = new WalkNode[2 * maxNodes];
+        for (int i = 0; i < numNodes; i++)
+            bigger[i] = nodes[i];
+        delete[] nodes;
+        nodes = bigger;
+        maxNodes *= 2;
+    }
+    WalkNode *n = &nodes[numNodes];
+    n->sector = sector;
+    n->isDir = isDir;
+    n->depth = depth;
+    strncpy(n->name, name, FileNameMaxLen);
+    n->name[FileNameMaxLen] = '\0';
+    n->firstChild = 0;
+    n->numChildren = 0;
+    return numNodes++;
+}
@@ -0,0 +1,67 @@
+// treewalk.h
+//	Data structures for reading a whole directory tree, a level at a
+//	time.
+//
+//	A depth-first walk reads one directory, then the next, in the
+//	order the tree lists them; on a wide tree the disk head goes back
+//	and forth across the disk once per directory.  Instead, we go
+//	breadth first: all the directories at one depth form a wave,
+//	sorted by header sector and read in one sweep (cf. wave.h, which
+//	the file system checker uses too).  The simulated disk serves one
+//	request at a time, so there is nothing to gain from reading a
+//	wave with several threads; the order is what matters.
+//
+//	The tree found is kept in memory, parents before children and
+//	each directory's entries together, in directory order, so that
+//	it can be printed (or taken apart) afterwards without going back
+//	to the disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef TREEWALK_H
+#define TREEWALK_H
+
+#include "directory.h"
+
+// A file or directory found by the walk.
+
+class WalkNode
+{
+public:
+    int sector;                    // where its header is
+    bool isDir;                    // is it a directory?
+    int depth;                     // 0 for the entries of the root
+    char name[FileNameMaxLen + 1]; // its name in its directory
+    int firstChild;                // for a directory, where its
+    int numChildren;               //  entries are in the node table
+};
+
+// The following class defines a walk of the tree under one directory.
+
+class TreeWalk
+{
+public:
+    TreeWalk(int rootSector); // Walk the tree under the directory
+                              //  with header "rootSector"
+    ~TreeWalk();
+
+    void Run();  // Read every directory in the tree
+    void List(); // Print the tree, indented by depth
+
+    int NumNodes() { return numNodes; } // Node 0 is the root itself
+    WalkNode *Node(int i) { return &nodes[i]; }
+
+private:
+    WalkNode *nodes; // what we found, in breadth-first order
+    int numNodes;
+    int maxNodes;
+
+    int AddNode(int sector, bool isDir, int depth, char *name);
+    void ListChildren(int node);
+};
+
+#endif // TREEWALK_H
@@ -0,0 +1,103 @@
+// wave.cc
+//	Routines to queue the sectors of a breadth-first walk, and read
+//	them one sorted wave at a time.  See wave.h.
+//
+//	The two waves are growable arrays, swapped at each NextWave, so
+//	that a walk allocates only when a wave is bigger than any before.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "directory.h"
+#include "wave.h"
+
+//----------------------------------------------------------------------
+// CompareItems
+// 	Order the sectors of a wave by where they are on disk, for qsort.
+//----------------------------------------------------------------------
+
+static int
+CompareItems(const void *a, const void *b)
+{
+    return ((WaveItem *)a)->sector - ((WaveItem *)b)->sector;
+}
+
+//----------------------------------------------------------------------
+// WaveQueue::WaveQueue
+// 	Initialize a walk, with nothing queued.
+//----------------------------------------------------------------------
+
+WaveQueue::WaveQueue()
+{
+    maxWave = maxNext = NumDirEntries;
+    wave = new WaveItem[maxWave];
+    next = new WaveItem[maxNext];
+    waveSize = nextSize = 0;
+}
+
+WaveQueue::~WaveQueue()
+{
+    delete[] wave;
+    delete[] next;
+}
+
+//----------------------------------------------------------------------
+// WaveQueue::Queue
+// 	Arrange for a sector to be read in the next wave of the walk.
+//----------------------------------------------------------------------
+
+void WaveQueue::Queue(int sector, int kind, int node, FileOffset offset,
+                      FileOffset size)
+{
+    if (nextSize == maxNext)
+    {
+        WaveItem *bigger = new WaveItem[maxNext * 2];
+        memcpy(bigger, next, maxNext * sizeof(WaveItem));
+        delete[] next;
+        next = bigger;
+        maxNext *= 2;
+    }
+    next[nextSize].sector = sector;
+    next[nextSize].kind = kind;
+    next[nextSize].node = node;
+    next[nextSize].offset = offset;
+    next[nextSize].size = size;
+    nextSize++;
+}
+
+//----------------------------------------------------------------------
+// WaveQueue::NextWave
+// 	Start the next wave: what was queued during the last one, sorted
+//	by sector.  Return FALSE if nothing was queued -- the walk is over.
+//----------------------------------------------------------------------
+
+bool WaveQueue::NextWave()
+{
+    WaveItem *items = wave; // what we found last time is
+    int room = maxWave;     //  what we read this time
+
+    wave = next;
+    maxWave = maxNext;
+    waveSize = nextSize;
+    next = items;
+    maxNext = room;
+    nextSize = 0;
+
+    if (waveSize == 0)
+        return FALSE;
+    qsort(wave, waveSize, sizeof(WaveItem), CompareItems);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// WaveQueue::Clear
+// 	Forget everything queued or being read.
+//----------------------------------------------------------------------
+
+void WaveQueue::Clear()
+{
+    waveSize = nextSize = 0;
+}
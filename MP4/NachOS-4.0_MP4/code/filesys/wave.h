@@ -0,0 +1,66 @@
+// wave.h
+//	Data structures for reading a tree of file system metadata breadth
+//	first, one sorted "wave" at a time.
+//
+//	A depth-first walk reads one header or directory, then the next,
+//	in the order the tree happens to list them; on a wide tree the
+//	disk head goes back and forth across the disk once per read.
+//	Instead, everything found while processing one wave is queued for
+//	the next, and each wave is sorted by sector number before it is
+//	read, so that it costs about one sweep of the head.
+//
+//	Used by the file system checker (fsck.h) and by the tree walk
+//	that lists and removes whole directory trees (treewalk.h).  The
+//	caller decides what an item is; the queue only keeps the items
+//	and puts them in order.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef WAVE_H
+#define WAVE_H
+
+#include "disk.h"
+
+// A sector to be read in some wave of the walk.
+class WaveItem
+{
+public:
+    int sector;        // where it is on disk
+    int kind;          // what it is (up to the caller)
+    int node;          // which node of the caller's it belongs to
+    FileOffset offset; // first byte of the file it covers
+    FileOffset size;   // for a header, how many bytes it should
+                       //  say it covers (-1 if we can't tell)
+};
+
+// The following class defines the waves of a walk: the one being
+// read, and the one being queued for next time.
+
+class WaveQueue
+{
+public:
+    WaveQueue();  // Nothing queued
+    ~WaveQueue();
+
+    void Queue(int sector, int kind, int node, FileOffset offset,
+               FileOffset size); // Read "sector" in the next wave
+    bool NextWave();             // Make the queued items the current
+                                 //  wave, sorted by sector; FALSE if
+                                 //  nothing was queued
+    void Clear();                // Forget both waves
+
+    int Size() { return waveSize; } // # of items in the current wave
+    WaveItem *Item(int i) { return &wave[i]; }
+
+private:
+    WaveItem *wave; // sectors to read in this wave
+    int waveSize, maxWave;
+    WaveItem *next; // sectors found for the next wave
+    int nextSize, maxNext;
+};
+
+#endif // WAVE_H
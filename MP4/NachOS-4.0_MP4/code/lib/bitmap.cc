@@ -122,6 +122,44 @@ int Bitmap::FindAndSet()
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetFrom
+// 	Like FindAndSet, but search starting from bit "start", going
+//	round to the beginning of the bitmap if need be, so that the bit
+//	we return is the closest clear bit after "start".  Words with
+//	every bit set are skipped whole.
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int Bitmap::FindAndSetFrom(int start)
+{
+    int i = (start >= 0 && start < numBits) ? start : 0;
+
+    for (int looked = 0; looked < numBits;)
+    {
+        if (i % BitsInWord == 0 && i + BitsInWord <= numBits &&
+            map[i / BitsInWord] == ~0u)
+        {
+            i += BitsInWord;
+            looked += BitsInWord;
+        }
+        else
+        {
+            if (!Test(i))
+            {
+                Mark(i);
+                return i;
+            }
+            i++;
+            looked++;
+        }
+        if (i >= numBits)
+            i = 0;
+    }
+    return -1;
+}
+
 //----------------------------------------------------------------------
 // Bitmap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -130,16 +168,36 @@ int Bitmap::FindAndSet()
 
 int Bitmap::NumClear() const
 {
-    int count = 0;
+    return NumClear(0, numBits);
+}
 
-    for (int i = 0; i < numBits; i++)
+//----------------------------------------------------------------------
+// Bitmap::NumClear
+// 	Return the number of clear bits among the "count" bits starting
+//	at bit "first".
+//----------------------------------------------------------------------
+
+int Bitmap::NumClear(int first, int count) const
+{
+    int clear = 0;
+
+    ASSERT(first >= 0 && count >= 0 && first + count <= numBits);
+    for (int i = first; i < first + count;)
     {
-        if (!Test(i))
+        if (i % BitsInWord == 0 && i + BitsInWord <= first + count)
+        { // a whole word at a time
+            for (unsigned int w = ~map[i / BitsInWord]; w != 0; w &= w - 1)
+                clear++;
+            i += BitsInWord;
+        }
+        else
         {
-            count++;
+            if (!Test(i))
+                clear++;
+            i++;
         }
     }
-    return count;
+    return clear;
 }
 
 //----------------------------------------------------------------------
@@ -35,15 +35,21 @@ class Bitmap
 public:
     Bitmap(int numItems); // Initialize a bitmap, with "numItems" bits
                           // initially, all bits are cleared.
-    ~Bitmap();            // De-allocate bitmap
+    virtual ~Bitmap();    // De-allocate bitmap
 
-    void Mark(int which);       // Set the "nth" bit
-    void Clear(int which);      // Clear the "nth" bit
+    virtual void Mark(int which);  // Set the "nth" bit
+    virtual void Clear(int which); // Clear the "nth" bit
+                                   // (virtual so a subclass can see
+                                   //  every change, cf. pbitmap.h)
     bool Test(int which) const; // Is the "nth" bit set?
-    int FindAndSet();           // Return the # of a clear bit, and as a side
+    virtual int FindAndSet();   // Return the # of a clear bit, and as a side
         // effect, set the bit.
         // If no bits are clear, return -1.
+    int FindAndSetFrom(int start); // Same, but take the first clear bit
+                                   //  at or after "start", wrapping around
     int NumClear() const; // Return the number of clear bits
+    int NumClear(int first, int count) const; // ... among "count" bits
+                                              //  starting at "first"
 
     void Print() const; // Print contents of bitmap
     void SelfTest();    // Test whether bitmap is working
@@ -23,12 +23,18 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
+// Offsets into the simulated disk can be past 2GB, even when Nachos is
+// compiled for a 32-bit host.
+#define _FILE_OFFSET_BITS 64
+
 #include "copyright.h"
 #include "debug.h"
 #include "sysdep.h"
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <dirent.h>
 #include <sys/file.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -107,6 +113,21 @@ int sendto (int, const void*, int, int, void*, int);
 
 }
 
+//----------------------------------------------------------------------
+// HostSeconds
+// 	Return the host's wall clock time, in seconds.  Only differences
+//	between two calls are meaningful.
+//----------------------------------------------------------------------
+
+double
+HostSeconds()
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // CallOnUserAbort
 // 	Arrange that "func" will be called when the user aborts (e.g., by
@@ -373,9 +394,9 @@ WriteFile(int fd, char *buffer, int nBytes)
 //----------------------------------------------------------------------
 
 void 
-Lseek(int fd, int offset, int whence)
+Lseek(int fd, long long offset, int whence)
 {
-    int retVal = lseek(fd, offset, whence);
+    off_t retVal = lseek(fd, (off_t) offset, whence);
     ASSERT(retVal >= 0);
 }
 
@@ -384,7 +405,7 @@ Lseek(int fd, int offset, int whence)
 // 	Report the current location within an open file.
 //----------------------------------------------------------------------
 
-int 
+long long 
 Tell(int fd)
 {
 #if defined(BSD) || defined(SOLARIS) || defined(LINUX)
@@ -395,6 +416,20 @@ Tell(int fd)
 #endif
 }
 
+//----------------------------------------------------------------------
+// SetLength
+// 	Make an open file exactly "length" bytes long, cutting it short or
+//	extending it with zeroes (which on most hosts take no space on
+//	disk until written).  Abort on error.
+//----------------------------------------------------------------------
+
+void 
+SetLength(int fd, long long length)
+{
+    int retVal = ftruncate(fd, (off_t) length);
+    ASSERT(retVal == 0);
+}
+
 
 //----------------------------------------------------------------------
 // Close
@@ -420,6 +455,60 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// IsDirectory
+// 	Return TRUE if the UNIX file "name" is a directory.
+//----------------------------------------------------------------------
+
+bool
+IsDirectory(char *name)
+{
+    struct stat st;
+
+    return stat(name, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+//----------------------------------------------------------------------
+// OpenDirectory
+// 	Open a UNIX directory for reading its entries.  Return NULL on
+//	error.
+//----------------------------------------------------------------------
+
+void *
+OpenDirectory(char *name)
+{
+    return (void *) opendir(name);
+}
+
+//----------------------------------------------------------------------
+// ReadDirectory
+// 	Return the name of the next entry in a directory opened with
+//	OpenDirectory, skipping "." and "..".  Return NULL at the end.
+//	The name is only good until the next call.
+//----------------------------------------------------------------------
+
+char *
+ReadDirectory(void *dir)
+{
+    struct dirent *entry;
+
+    while ((entry = readdir((DIR *) dir)) != NULL)
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+            return entry->d_name;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// CloseDirectory
+// 	Close a directory opened with OpenDirectory.
+//----------------------------------------------------------------------
+
+void
+CloseDirectory(void *dir)
+{
+    closedir((DIR *) dir);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
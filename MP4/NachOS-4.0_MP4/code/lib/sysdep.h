@@ -24,6 +24,7 @@ extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);// rcgood - to avoid spinners.
+extern double HostSeconds();	// wall clock time, for throughput reports
 
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
@@ -48,11 +49,18 @@ extern int OpenForReadWrite(char *name, bool crashOnError);
 extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, char *buffer, int nBytes);
-extern void Lseek(int fd, int offset, int whence);
-extern int Tell(int fd);
+extern void Lseek(int fd, long long offset, int whence);
+extern long long Tell(int fd);
+extern void SetLength(int fd, long long length);
 extern int Close(int fd);
 extern bool Unlink(char *name);
 
+// Directory operations: for copying whole directory trees into Nachos.
+extern bool IsDirectory(char *name);
+extern void *OpenDirectory(char *name);
+extern char *ReadDirectory(void *dir);	// next name, or NULL at the end
+extern void CloseDirectory(void *dir);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
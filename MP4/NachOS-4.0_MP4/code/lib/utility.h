@@ -35,4 +35,9 @@
 typedef void (*VoidFunctionPtr)(void *arg); 
 typedef void (*VoidNoArgFunctionPtr)(); 
 
+// Byte offsets within files (and within the simulated disk) are 64 bits,
+// so that neither is limited to 2GB.
+
+typedef long long FileOffset;
+
 #endif // UTILITY_H
@@ -25,7 +25,9 @@
 
 const int MagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
+
+// How big the UNIX file is for a disk of "numSectors" sectors.
+#define DiskSize(numSectors) (MagicSize + ((FileOffset)(numSectors) * SectorSize))
 
 //----------------------------------------------------------------------
 // Disk::Disk()
@@ -33,13 +35,16 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 //	if it doesn't exist), and check the magic number to make sure it's
 // 	ok to treat it as Nachos disk storage.
 //
+//	An existing disk keeps the size it was created with, unless a
+//	size is asked for (as when the disk is about to be formatted).
+//
 //	"toCall" -- object to call when disk read/write request completes
+//	"size" -- # of sectors on the disk, or 0 for "as it was"
 //----------------------------------------------------------------------
 
-Disk::Disk(CallBackObj *toCall)
+Disk::Disk(CallBackObj *toCall, int size)
 {
     int magicNum;
-    int tmp = 0;
 
     DEBUG(dbgDisk, "Initializing the disk.");
     callWhenDone = toCall;
@@ -52,17 +57,28 @@ Disk::Disk(CallBackObj *toCall)
     { // file exists, check magic number
         Read(fileno, (char *)&magicNum, MagicSize);
         ASSERT(magicNum == MagicNumber);
+        Lseek(fileno, 0, 2);
+        numSectors = (int)((Tell(fileno) - MagicSize) / SectorSize);
     }
     else
     { // file doesn't exist, create it
         fileno = OpenForWrite(diskname);
         magicNum = MagicNumber;
         WriteFile(fileno, (char *)&magicNum, MagicSize); // write magic number
+        numSectors = 0;
+        if (size <= 0)
+            size = DefaultNumSectors;
+    }
 
-        // need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);
-        WriteFile(fileno, (char *)&tmp, sizeof(int));
+    // need to extend to the end of the disk, so that reads will not
+    // return EOF
+    if (size > 0 && size != numSectors)
+    {
+        numSectors = size;
+        SetLength(fileno, DiskSize(numSectors));
     }
+    ASSERT(numSectors > 0);
+    DEBUG(dbgDisk, "The disk has " << numSectors << " sectors.");
     active = FALSE;
 }
 
@@ -118,10 +134,10 @@ void Disk::ReadRequest(int sectorNumber, char *data)
     int ticks = ComputeLatency(sectorNumber, FALSE);
 
     ASSERT(!active); // only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
 
     DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+    Lseek(fileno, (FileOffset)SectorSize * sectorNumber + MagicSize, 0);
     Read(fileno, data, SectorSize);
     if (debug->IsEnabled('d'))
         PrintSector(FALSE, sectorNumber, data);
@@ -137,13 +153,13 @@ void Disk::WriteRequest(int sectorNumber, char *data)
     int ticks = ComputeLatency(sectorNumber, TRUE);
 
     ASSERT(!active);
-    if(sectorNumber < 0 || sectorNumber > NumSectors){
+    if(sectorNumber < 0 || sectorNumber > numSectors){
         DEBUG(dbgDisk, "sectorNumber is " << sectorNumber);
     }
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
 
     DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+    Lseek(fileno, (FileOffset)SectorSize * sectorNumber + MagicSize, 0);
     WriteFile(fileno, data, SectorSize);
     if (debug->IsEnabled('d'))
         PrintSector(TRUE, sectorNumber, data);
@@ -251,7 +267,7 @@ int Disk::ComputeLatency(int newSector, bool writing)
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
-//	what is in the track buffer.
+//	what is in the track buffer.  Also count the seek, if there was one.
 //----------------------------------------------------------------------
 
 void Disk::UpdateLast(int newSector)
@@ -260,7 +276,11 @@ void Disk::UpdateLast(int newSector)
     int seek = TimeToSeek(newSector, &rotate);
 
     if (seek != 0)
+    {
         bufferInit = kernel->stats->totalTicks + seek + rotate;
+        kernel->stats->numDiskSeeks++;
+        kernel->stats->diskSeekTicks += seek;
+    }
     lastSector = newSector;
     DEBUG(dbgDisk, "Updating last sector = " << lastSector << " , " << bufferInit);
 }
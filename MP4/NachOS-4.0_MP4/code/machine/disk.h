@@ -46,18 +46,25 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// The size of a sector and of a track are fixed, but the number of tracks
+// is not: it is chosen when the disk is created, and is remembered in the
+// length of the UNIX file.
 
 const int SectorSize = 128;		// number of bytes per disk sector
 const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 16384;		// number of tracks per disk
-const int NumSectors = (SectorsPerTrack * NumTracks);
-					// total # of sectors per disk
+const int DefaultNumTracks = 16384;	// number of tracks on a new disk,
+const int DefaultNumSectors = (SectorsPerTrack * DefaultNumTracks);
+					//  if no size is asked for
 
 class Disk : public CallBackObj {
   public:
-    Disk(CallBackObj *toCall);          // Create a simulated disk.  
+    Disk(CallBackObj *toCall, int numSectors);
+    					// Create a simulated disk.  
 					// Invoke toCall->CallBack() 
 					// when each request completes.
+					// If "numSectors" > 0, make the
+					// disk that big.
     ~Disk();				// Deallocate the disk.
     
     void ReadRequest(int sectorNumber, char* data);
@@ -70,6 +77,9 @@ class Disk : public CallBackObj {
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
 
+    int NumSectors() { return numSectors; }
+					// total # of sectors on the disk
+
     int ComputeLatency(int newSector, bool writing);	
     					// Return how long a request to 
 					// newSector will take: 
@@ -78,6 +88,7 @@ class Disk : public CallBackObj {
   private:
     int fileno;				// UNIX file number for simulated disk 
     char diskname[32];			// name of simulated disk's file
+    int numSectors;			// how big the disk is
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
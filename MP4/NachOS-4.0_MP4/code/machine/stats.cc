@@ -20,6 +20,7 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numDiskSeeks = diskSeekTicks = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
 }
@@ -36,7 +37,9 @@ Statistics::Print()
     cout << "Ticks: total " << totalTicks << ", idle " << idleTicks;
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
-		cout << ", writes " << numDiskWrites << "\n";
+		cout << ", writes " << numDiskWrites;
+		cout << ", seeks " << numDiskSeeks << " (" << diskSeekTicks
+		     << " ticks)\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
@@ -30,6 +30,8 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskSeeks;		// number of requests that moved the disk head
+    int diskSeekTicks;		// time spent moving it (cf. Disk::TimeToSeek)
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
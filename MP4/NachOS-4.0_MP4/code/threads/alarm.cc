@@ -11,6 +11,7 @@
 #include "copyright.h"
 #include "alarm.h"
 #include "main.h"
+#include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // Alarm::Alarm
@@ -41,6 +42,8 @@ Alarm::Alarm(bool doRandom)
 //
 //	For now, just provide time-slicing.  Only need to time slice 
 //      if we're currently running something (in other words, not idle).
+//	The disk also counts ticks, to write back delayed writes now
+//	and then.
 //----------------------------------------------------------------------
 
 void 
@@ -49,6 +52,7 @@ Alarm::CallBack()
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
     
+    kernel->synchDisk->TimerTick();
     if (status != IdleMode) {
 	interrupt->YieldOnReturn();
     }
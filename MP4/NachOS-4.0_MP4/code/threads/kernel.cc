@@ -28,8 +28,10 @@ Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
     debugUserProg = FALSE;
+    writeBack = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
+    diskSize = 0;              // default is whatever the disk has
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
@@ -49,6 +51,8 @@ Kernel::Kernel(int argc, char **argv)
 	    	i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+        } else if (strcmp(argv[i], "-wb") == 0) {
+            writeBack = TRUE;
 		} else if (strcmp(argv[i], "-e") == 0) {
         	execfile[++execfileNum]= argv[++i];
 			cout << execfile[execfileNum] << "\n";
@@ -63,6 +67,11 @@ Kernel::Kernel(int argc, char **argv)
 #ifndef FILESYS_STUB
 		} else if (strcmp(argv[i], "-f") == 0) {
 	    	formatFlag = TRUE;
+		} else if (strcmp(argv[i], "-ds") == 0) {
+	    	ASSERT(i + 1 < argc);   // next argument is # of megabytes
+	    	diskSize = divRoundUp(atoi(argv[i + 1]) * (1024 * 1024 / SectorSize),
+	    	                      SectorsPerTrack) * SectorsPerTrack;
+	    	i++;
 #endif
         } else if (strcmp(argv[i], "-n") == 0) {
             ASSERT(i + 1 < argc);   // next argument is float
@@ -75,13 +84,21 @@ Kernel::Kernel(int argc, char **argv)
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
 	   		cout << "Partial usage: nachos [-s]\n";
+	   		cout << "Partial usage: nachos [-wb]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
+	    	cout << "Partial usage: nachos [-f [-ds megabytes]]\n";
 #endif
             cout << "Partial usage: nachos [-n #] [-m #]\n";
 		}
     }
+#ifndef FILESYS_STUB
+    if (diskSize > 0 && !formatFlag) { // a file system can't change size
+        cout << "Ignoring -ds: the disk size is only set by -f\n";
+        diskSize = 0;
+    }
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -109,7 +126,7 @@ Kernel::Initialize()
     machine = new Machine(debugUserProg);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
-    synchDisk = new SynchDisk();    //
+    synchDisk = new SynchDisk(writeBack, diskSize);
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
@@ -153,8 +170,8 @@ Kernel::~Kernel()
     delete machine;
     delete synchConsoleIn;
     delete synchConsoleOut;
+    delete fileSystem; // before the disk it uses
     delete synchDisk;
-    delete fileSystem;
 	
 	// Mp4 mod tag
 	/*
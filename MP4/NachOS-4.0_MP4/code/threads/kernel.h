@@ -78,9 +78,12 @@ class Kernel {
 	int threadNum;
     bool randomSlice;		// enable pseudo-random time slicing
     bool debugUserProg;         // single step user program
+    bool writeBack;             // delay disk writes in the cache
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
+    int diskSize;               // # of sectors on the disk, or 0
+                                //  to keep the size it has
 #ifndef FILESYS_STUB
     bool formatFlag;          // format the disk if this is true
 #endif
@@ -4,8 +4,9 @@
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
-//              -f -cp <unix file> <nachos file>
-//              -p <nachos file> -r <nachos file> -l -D
+//              -f -ds <megabytes> -wb -cp <unix file> <nachos file>
+//              -cpr <unix directory> <nachos directory>
+//              -p <nachos file> -r <nachos file> -l -D -fsck -fsckr
 //              -n <network reliability> -m <machine id>
 //              -z -K -C -N
 //
@@ -24,11 +25,16 @@
 //
 //    Filesystem-related flags:
 //    -f forces the Nachos disk to be formatted
+//    -ds makes the newly formatted disk this many megabytes
+//    -wb delays disk writes in a cache, written back in the background
 //    -cp copies a file from UNIX to Nachos
+//    -cpr copies a whole UNIX directory tree into a new Nachos directory
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system
+//    -fsck checks the file system for consistency, before anything else
+//    -fsckr checks it and repairs what it can
 //
 //  Note: the file system flags are not used if the stub filesystem
 //        is being used
@@ -45,6 +51,8 @@
 #include "filesys.h"
 #include "openfile.h"
 #include "sysdep.h"
+#include "directory.h"
+#include "disk.h"
 
 // global variables
 Kernel *kernel;
@@ -79,7 +87,8 @@ static void Copy(char *from, char *to)
 {
     int fd;
     OpenFile *openFile;
-    int amountRead, fileLength;
+    int amountRead;
+    FileOffset fileLength;
     char *buffer;
 
     // Open UNIX file
@@ -120,6 +129,179 @@ static void Copy(char *from, char *to)
     Close(fd);
 }
 
+//-------------------------------------------------------------------
+// Constant used by "Import"
+//   The number of bytes moved per write.  A multiple of SectorSize,
+//   so every write but the last in a file covers whole sectors.
+//-------------------------------------------------------------------
+static const int ImportTransferSize = 64 * SectorSize;
+
+//----------------------------------------------------------------------
+// ImportTree
+//      One pass of Import over the UNIX directory "from", which
+//	corresponds to the Nachos directory "to".
+//
+//	In the first pass ("createPass" TRUE), create every directory,
+//	and every file at its full size.  Files are sparse, so that
+//	allocates no data sectors: they are allocated as the second
+//	pass copies the file data, and that is where the disk may fill
+//	up.  A file that doesn't fit is reported, and only the bytes
+//	actually written are counted.
+//
+//	"numFiles", "numDirs" and "numBytes" count what was imported.
+//----------------------------------------------------------------------
+
+static void ImportTree(char *from, char *to, bool createPass,
+                       int *numFiles, int *numDirs, FileOffset *numBytes)
+{
+    void *dir;
+    char *entry;
+    char fromPath[256], toPath[256], name[256];
+
+    if ((dir = OpenDirectory(from)) == NULL)
+    {
+        printf("Import: couldn't open input directory %s\n", from);
+        return;
+    }
+    while ((entry = ReadDirectory(dir)) != NULL)
+    {
+        if (strlen(entry) > FileNameMaxLen)
+        {
+            if (createPass)
+                printf("Import: skipping %s/%s, name too long\n", from, entry);
+            continue;
+        }
+        if (snprintf(fromPath, sizeof(fromPath), "%s/%s", from, entry) >=
+                (int)sizeof(fromPath) ||
+            snprintf(toPath, sizeof(toPath), "%s%s%s", to,
+                     to[strlen(to) - 1] == '/' ? "" : "/", entry) >=
+                (int)sizeof(toPath))
+        {
+            if (createPass)
+                printf("Import: skipping %s/%s, path too long\n", from, entry);
+            continue;
+        }
+        strcpy(name, toPath); // the file system chops up its argument
+
+        if (IsDirectory(fromPath))
+        {
+            if (createPass)
+            {
+                if (!kernel->fileSystem->CreateDirectory(name))
+                {
+                    printf("Import: couldn't create output directory %s\n", toPath);
+                    continue;
+                }
+                (*numDirs)++;
+            }
+            ImportTree(fromPath, toPath, createPass, numFiles, numDirs, numBytes);
+            continue;
+        }
+
+        int fd, amountRead, amountWritten;
+        FileOffset fileLength, position;
+        if ((fd = OpenForReadWrite(fromPath, FALSE)) < 0)
+        {
+            if (createPass)
+                printf("Import: couldn't open input file %s\n", fromPath);
+            continue;
+        }
+        Lseek(fd, 0, 2);
+        fileLength = Tell(fd);
+        Lseek(fd, 0, 0);
+
+        if (createPass)
+        {
+            if (!kernel->fileSystem->Create(name, fileLength))
+                printf("Import: couldn't create output file %s\n", toPath);
+        }
+        else
+        {
+            OpenFile *openFile = kernel->fileSystem->Open(name);
+            if (openFile != NULL)
+            {
+                char *buffer = new char[ImportTransferSize];
+                position = 0;
+                amountWritten = 0;
+                while ((amountRead = ReadPartial(fd, buffer, ImportTransferSize)) > 0)
+                {
+                    amountWritten = openFile->WriteAt(buffer, amountRead, position);
+                    position += amountWritten;
+                    if (amountWritten < amountRead)
+                        break;
+                }
+                delete[] buffer;
+                delete openFile;
+                if (amountWritten < amountRead)
+                    printf("Import: disk full, only %lld of %lld bytes of %s copied\n",
+                           position, fileLength, toPath);
+                else
+                    (*numFiles)++;
+                *numBytes += position;
+            }
+        }
+        Close(fd);
+    }
+    CloseDirectory(dir);
+}
+
+//----------------------------------------------------------------------
+// Import
+//      Copy the UNIX directory tree "from" into the Nachos directory
+//	"to", which is created (use "/" to import into the root).
+//
+//	Unlike a series of Copy's, the directories and file headers all
+//	go to the journal as a single commit, and the data is then
+//	written in large sector-aligned chunks (its sectors are
+//	allocated as it is written).  Prints the throughput when done.
+//----------------------------------------------------------------------
+
+static void Import(char *from, char *to)
+{
+    int numFiles = 0, numDirs = 0;
+    FileOffset numBytes = 0;
+    int startTicks = kernel->stats->totalTicks;
+    double startTime = HostSeconds();
+    double hostTime;
+    int ticks;
+    char name[256];
+
+    if (!IsDirectory(from))
+    {
+        printf("Import: %s is not a directory\n", from);
+        return;
+    }
+
+    if (snprintf(name, sizeof(name), "%s", to) >= (int)sizeof(name))
+    {
+        printf("Import: %s is too long a path\n", to);
+        return;
+    }
+
+    kernel->fileSystem->BeginBatch();
+    if (strcmp(to, "/") != 0)
+    {
+        if (!kernel->fileSystem->CreateDirectory(name))
+        {
+            printf("Import: couldn't create output directory %s\n", to);
+            kernel->fileSystem->EndBatch();
+            return;
+        }
+        numDirs++;
+    }
+    ImportTree(from, to, TRUE, &numFiles, &numDirs, &numBytes);
+    kernel->fileSystem->EndBatch();
+
+    ImportTree(from, to, FALSE, &numFiles, &numDirs, &numBytes);
+
+    ticks = kernel->stats->totalTicks - startTicks;
+    hostTime = HostSeconds() - startTime;
+    printf("Import: %d files, %d directories, %lld bytes\n", numFiles, numDirs, numBytes);
+    printf("Import: %d simulated ticks (%.1f bytes/tick), %.3f host seconds (%.0f bytes/s)\n",
+           ticks, ticks > 0 ? (double)numBytes / ticks : 0.0,
+           hostTime, hostTime > 0 ? numBytes / hostTime : 0.0);
+}
+
 #endif // FILESYS_STUB
 
 //----------------------------------------------------------------------
@@ -157,7 +339,8 @@ void Print(char *name)
 static void CreateDirectory(char *name)
 {
     // MP4 Assignment
-    kernel->fileSystem->CreateDirectory(name);
+    if (!kernel->fileSystem->CreateDirectory(name))
+        printf("CreateDirectory: no room for the new directory\n");
 }
 
 //----------------------------------------------------------------------
@@ -185,6 +368,8 @@ int main(int argc, char **argv)
 #ifndef FILESYS_STUB
     char *copyUnixFileName = NULL;   // UNIX file to be copied into Nachos
     char *copyNachosFileName = NULL; // name of copied file in Nachos
+    char *importUnixDirName = NULL;  // UNIX directory tree to import
+    char *importNachosDirName = NULL; // where to put it in Nachos
     char *printFileName = NULL;
     char *removeFileName = NULL;
     bool dirListFlag = false;
@@ -196,6 +381,8 @@ int main(int argc, char **argv)
     bool recursiveListFlag = false;
     bool recursiveRemoveFlag = false;
     bool showHeaderSize = false;
+    bool checkFlag = false;  // check the file system at boot
+    bool repairFlag = false; //  and repair it
 #endif //FILESYS_STUB
 
     // some command line arguments are handled here.
@@ -239,6 +426,13 @@ int main(int argc, char **argv)
             copyNachosFileName = argv[i + 2];
             i += 2;
         }
+        else if (strcmp(argv[i], "-cpr") == 0)
+        {
+            ASSERT(i + 2 < argc);
+            importUnixDirName = argv[i + 1];
+            importNachosDirName = argv[i + 2];
+            i += 2;
+        }
         else if (strcmp(argv[i], "-p") == 0)
         {
             ASSERT(i + 1 < argc);
@@ -293,6 +487,15 @@ int main(int argc, char **argv)
         {
             showHeaderSize = true;
         }
+        else if (strcmp(argv[i], "-fsck") == 0)
+        {
+            checkFlag = true;
+        }
+        else if (strcmp(argv[i], "-fsckr") == 0)
+        {
+            checkFlag = true;
+            repairFlag = true;
+        }
 #endif //FILESYS_STUB
         else if (strcmp(argv[i], "-u") == 0)
         {
@@ -301,8 +504,10 @@ int main(int argc, char **argv)
             cout << "Partial usage: nachos [-K] [-C] [-N]\n";
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
+            cout << "Partial usage: nachos [-cpr UnixDir NachosDir]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
             cout << "Partial usage: nachos [-l] [-D]\n";
+            cout << "Partial usage: nachos [-fsck] [-fsckr]\n";
 #endif //FILESYS_STUB
         }
     }
@@ -316,6 +521,13 @@ int main(int argc, char **argv)
 
     CallOnUserAbort(Cleanup); // if user hits ctl-C
 
+#ifndef FILESYS_STUB
+    if (checkFlag)
+    { // before anything else touches the disk
+        kernel->fileSystem->Check(repairFlag);
+    }
+#endif // FILESYS_STUB
+
     // at this point, the kernel is ready to do something
     // run some tests, if requested
     if (threadTestFlag)
@@ -343,6 +555,10 @@ int main(int argc, char **argv)
     {
         Copy(copyUnixFileName, copyNachosFileName);
     }
+    if (importUnixDirName != NULL && importNachosDirName != NULL)
+    {
+        Import(importUnixDirName, importNachosDirName);
+    }
     if (dumpFlag)
     {
         kernel->fileSystem->Print();
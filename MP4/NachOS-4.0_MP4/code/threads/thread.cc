@@ -21,6 +21,7 @@
 #include "switch.h"
 #include "synch.h"
 #include "sysdep.h"
+#include "synchdisk.h"
 
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
@@ -248,6 +249,8 @@ Thread::Sleep (bool finishing)
     status = BLOCKED;
 	//cout << "debug Thread::Sleep " << name << "wait for Idle\n";
     while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
+		if (kernel->synchDisk->WakeFlusher())
+			continue;		// write back delayed writes first
 		kernel->PrepareToEnd();
 		kernel->interrupt->Idle();	// no one to run, wait for an interrupt
 	}    
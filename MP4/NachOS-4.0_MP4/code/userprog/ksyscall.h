@@ -14,9 +14,13 @@
 #include "kernel.h"
 
 #include "synchconsole.h"
+#include "synchdisk.h"
 
 void SysHalt()
 {
+	kernel->fileSystem->Reap();	// free removed files
+	if (!kernel->synchDisk->Flush())	// don't lose delayed writes
+		cerr << "Halt: disk full, buffered file data could not be written\n";
 	kernel->interrupt->Halt();
 }
 
@@ -50,6 +54,20 @@ int SysClose(OpenFileId id)
     return kernel->fileSystem->CloseFile();
 }
 
+int SysSync()
+{
+    kernel->fileSystem->Reap();
+    return kernel->synchDisk->Flush() ? 1 : -1; // -1: file data found no room
+}
+
+int SysFsync(OpenFileId id)
+{
+    // the cache is small, so flushing all of it costs little more
+    // than finding the sectors that belong to this file
+    if (kernel->fileSystem->activeFile == NULL) return 0;
+    return kernel->synchDisk->Flush() ? 1 : -1;
+}
+
 #ifdef FILESYS_STUB
 int SysCreate(char *filename)
 {
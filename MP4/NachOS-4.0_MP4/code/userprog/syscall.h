@@ -34,6 +34,8 @@
 #define SC_ExecV	13
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
+#define SC_Sync		16
+#define SC_Fsync	17
 #define SC_Add		42
 #define SC_MSG		100
 
@@ -150,6 +152,18 @@ int Seek(int position, OpenFileId id);
  */
 int Close(OpenFileId id);
 
+/* Write every delayed disk write, and every finished file system
+ * operation, to disk before returning.
+ * Return 1 on success, -1 if delayed file data found no room on disk
+ */
+int Sync();
+
+/* Make the writes to the open file "id" durable before returning.
+ * Return 1 on success, 0 if the file is not open, -1 if its data
+ * found no room on disk.
+ */
+int Fsync(OpenFileId id);
+
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 
@@ -0,0 +1,1017 @@
+// mkfs.cc
+//	Build a formatted Nachos disk image, with directories and files
+//	already on it, without running Nachos; and check an existing
+//	image.
+//
+//	Populating a disk with "nachos -f", then one "nachos -cp" or
+//	"nachos -mkdir" per file, boots the whole simulated machine each
+//	time and pays simulated disk latency for every sector.  This
+//	program lays out the same on-disk structures (free map, file
+//	headers, directories, journal header) directly in the image file,
+//	using the layout constants in ../code/filesys, so the result is
+//	what Nachos itself would have produced.
+//
+//	Usage:
+//	    mkfs [-o image] [-s megabytes] manifest
+//					build "image" (default DISK_0),
+//					of the default size unless -s
+//	    mkfs -v image [manifest]	check "image"; with a manifest,
+//					also compare file contents
+//
+//	Each manifest line is one of:
+//	    d <nachos dir>			make a directory
+//	    f <unix file> <nachos file>		copy a file
+//	    r <unix dir> <nachos dir>		copy a directory tree
+//	    # ...				a comment
+//	Lines are processed in order, so a directory must be made before
+//	anything is put in it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+// The Nachos headers go first: utility.h defines NULL itself, and the
+// system headers then quietly define it their way.
+#include "copyright.h"
+#include "disk.h"
+#include "directory.h"
+#include "filehdr.h"
+#include "fslayout.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// Same as in ../code/machine/disk.cc: the image starts with a magic
+// number, followed by the sectors.
+const int MagicNumber = 0x456789ab;
+const int MagicSize = sizeof(int);
+
+// The on-disk form of a FileHeader (see ../code/filesys/filehdr.h).
+// The number of entries in use is not stored; it follows from the
+// length.  A file of at most InlineSize bytes keeps its data in
+// place of the table.
+struct Header
+{
+    FileOffset numBytes;
+    int dataSectors[NumDirect];
+};
+
+// A directory being built: where it lives, and its entries.
+struct Dir
+{
+    char path[256];
+    int sector;   // its header
+    int *sectors; // data sectors holding the table
+    DirectoryEntry table[NumDirEntries];
+};
+
+static FILE *image;
+static int numSectors = DefaultNumSectors; // size of the image
+static unsigned int *freeMap;
+static int goal = 0; // where FindAndSet starts looking
+
+static Dir *dirs[1024];
+static int numDirs = 0;
+static int numErrors = 0;
+
+//----------------------------------------------------------------------
+// Error
+//	Report a problem with the manifest or the image.
+//----------------------------------------------------------------------
+
+static void
+Error(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    fprintf(stderr, "mkfs: ");
+    vfprintf(stderr, format, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    numErrors++;
+}
+
+//----------------------------------------------------------------------
+// ReadSector/WriteSector
+//	Access a sector of the image file.  Files are mostly laid out in
+//	consecutive sectors, so we only seek when we have to, and let
+//	stdio turn runs of sectors into large writes.
+//----------------------------------------------------------------------
+
+static FileOffset position = -1; // where the image file is, or -1 if unknown
+
+static void
+SeekSector(int sector)
+{
+    FileOffset offset = MagicSize + (FileOffset)sector * SectorSize;
+
+    if (offset != position)
+        fseeko(image, offset, SEEK_SET);
+    position = offset + SectorSize;
+}
+
+static void
+ReadSector(int sector, void *data)
+{
+    SeekSector(sector);
+    if (fread(data, SectorSize, 1, image) != 1)
+    {
+        memset(data, 0, SectorSize);
+        position = -1;
+    }
+}
+
+static void
+WriteSector(int sector, const void *data)
+{
+    SeekSector(sector);
+    fwrite(data, SectorSize, 1, image);
+}
+
+//----------------------------------------------------------------------
+// NewFreeMap/Mark/Test/FindAndSet/NumClear
+//	The free map, as in ../code/lib/bitmap.cc.  It is rounded up to
+//	whole sectors, since it is written a sector at a time.
+//	FindAndSet allocates from a goal that then moves past the
+//	sector it returns, as in ../code/filesys/pbitmap.cc.
+//----------------------------------------------------------------------
+
+static void
+NewFreeMap()
+{
+    int numWords = divRoundUp(FreeMapFileSize(numSectors), SectorSize)
+                   * (SectorSize / sizeof(int));
+
+    freeMap = new unsigned int[numWords];
+    memset(freeMap, 0, numWords * sizeof(int));
+}
+
+static void
+Mark(int which)
+{
+    freeMap[which / BitsInWord] |= 1 << (which % BitsInWord);
+}
+
+static bool
+Test(int which)
+{
+    return (freeMap[which / BitsInWord] & (1 << (which % BitsInWord))) != 0;
+}
+
+static int
+FindAndSet()
+{
+    int i = (goal < numSectors) ? goal : 0;
+
+    for (int looked = 0; looked < numSectors;)
+    {
+        if (i % BitsInWord == 0 && i + BitsInWord <= numSectors &&
+            freeMap[i / BitsInWord] == ~0u)
+        { // skip a full word
+            i += BitsInWord;
+            looked += BitsInWord;
+        }
+        else if (!Test(i))
+        {
+            Mark(i);
+            goal = i + 1;
+            return i;
+        }
+        else
+        {
+            i++;
+            looked++;
+        }
+        if (i >= numSectors)
+            i = 0;
+    }
+    return -1;
+}
+
+static int
+NumClear(int first, int count)
+{
+    int clear = 0;
+
+    for (int i = first; i < first + count;)
+    {
+        if (i % BitsInWord == 0 && i + BitsInWord <= first + count)
+        {
+            for (unsigned int w = ~freeMap[i / BitsInWord]; w != 0; w &= w - 1)
+                clear++;
+            i += BitsInWord;
+        }
+        else
+        {
+            if (!Test(i))
+                clear++;
+            i++;
+        }
+    }
+    return clear;
+}
+
+//----------------------------------------------------------------------
+// DirectoryGoal
+//	Where to allocate a new subdirectory of the directory whose
+//	header is "parentSector", as in FileSystem::DirectoryGoal: in
+//	the parent's block group, unless it has less free space than
+//	the average group.
+//----------------------------------------------------------------------
+
+static int
+DirectoryGoal(int parentSector)
+{
+    int numGroups = divRoundUp(numSectors, SectorsPerGroup);
+    int average = NumClear(0, numSectors) / numGroups;
+    int first = parentSector / SectorsPerGroup;
+
+    for (int i = 0; i < numGroups; i++)
+    {
+        int group = (first + i) % numGroups;
+        int start = group * SectorsPerGroup;
+
+        if (NumClear(start, min(SectorsPerGroup, numSectors - start)) >= average)
+            return (group == first) ? parentSector : start;
+    }
+    return parentSector;
+}
+
+//----------------------------------------------------------------------
+// LevelSize
+//	How many bytes of a file of "numBytes" each entry of its header
+//	covers, as in FileHeader::LevelSize.
+//----------------------------------------------------------------------
+
+static FileOffset
+LevelSize(FileOffset numBytes)
+{
+    FileOffset level = SectorSize;
+
+    while (numBytes > 0 && (numBytes - 1) / level >= (FileOffset)NumDirect)
+        level *= NumDirect;
+    return level;
+}
+
+//----------------------------------------------------------------------
+// Allocate
+//	Fill in "hdr" for a file of "fileSize" bytes, allocating its
+//	index and data sectors exactly as FileHeader::Allocate does,
+//	and writing the index headers.  The data sectors are appended,
+//	in file order, to "leaves".
+//
+//	Returns FALSE if the disk is full.
+//----------------------------------------------------------------------
+
+static bool
+Allocate(Header *hdr, FileOffset fileSize, int *leaves, int *numLeaves)
+{
+    FileOffset levelSize = LevelSize(fileSize);
+    int count = divRoundUp(fileSize, levelSize);
+
+    memset(hdr, 0, sizeof(Header));
+    hdr->numBytes = fileSize;
+    for (int i = 0; i < count; i++)
+    {
+        Header sub;
+
+        if ((hdr->dataSectors[i] = FindAndSet()) < 0)
+            return FALSE;
+        if (levelSize == SectorSize)
+        {
+            leaves[(*numLeaves)++] = hdr->dataSectors[i];
+            continue;
+        }
+        if (!Allocate(&sub, min(levelSize, fileSize - i * levelSize),
+                      leaves, numLeaves))
+            return FALSE;
+        WriteSector(hdr->dataSectors[i], &sub);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FindDir
+//	Return the directory being built whose path is "path", or NULL.
+//----------------------------------------------------------------------
+
+static Dir *
+FindDir(const char *path)
+{
+    for (int i = 0; i < numDirs; i++)
+        if (strcmp(dirs[i]->path, path) == 0)
+            return dirs[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddEntry
+//	Allocate a header sector for "path" and enter it in its parent
+//	directory, as Directory::Add does.  Returns the sector, or -1.
+//----------------------------------------------------------------------
+
+static int
+AddEntry(const char *path, bool isDir)
+{
+    char parent[256];
+    const char *name = strrchr(path, '/');
+    Dir *dir;
+    int sector, i;
+
+    if (name == NULL || path[0] != '/')
+    {
+        Error("%s: not an absolute path", path);
+        return -1;
+    }
+    name++;
+    if (strlen(name) == 0 || strlen(name) > FileNameMaxLen)
+    {
+        Error("%s: bad name", path);
+        return -1;
+    }
+    strncpy(parent, path, name - path);
+    parent[name - path] = '\0';
+    if (strlen(parent) > 1)
+        parent[strlen(parent) - 1] = '\0'; // drop the trailing '/'
+    if ((dir = FindDir(parent)) == NULL)
+    {
+        Error("%s: parent directory does not exist", path);
+        return -1;
+    }
+
+    for (i = 0; i < NumDirEntries; i++)
+        if (dir->table[i].inUse && strcmp(dir->table[i].name, name) == 0)
+        {
+            Error("%s: already exists", path);
+            return -1;
+        }
+    for (i = 0; i < NumDirEntries; i++)
+        if (!dir->table[i].inUse)
+            break;
+    if (i == NumDirEntries)
+    {
+        Error("%s: directory full", path);
+        return -1;
+    }
+    goal = isDir ? DirectoryGoal(dir->sector) : dir->sector;
+    if ((sector = FindAndSet()) < 0)
+    {
+        Error("%s: disk full", path);
+        return -1;
+    }
+    dir->table[i].inUse = TRUE;
+    dir->table[i].isDir = isDir;
+    dir->table[i].sector = sector;
+    strncpy(dir->table[i].name, name, FileNameMaxLen);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// MakeDir
+//	Create the directory "path" (the root if "headerSector" is
+//	already known), as FileSystem::CreateDirectory does.
+//----------------------------------------------------------------------
+
+static void
+MakeDir(const char *path, int headerSector)
+{
+    Header hdr;
+    Dir *dir;
+    int numLeaves = 0;
+
+    if (numDirs == sizeof(dirs) / sizeof(dirs[0]))
+    {
+        Error("%s: too many directories", path);
+        return;
+    }
+    if (headerSector < 0 && (headerSector = AddEntry(path, TRUE)) < 0)
+        return;
+    dir = new Dir;
+    memset(dir, 0, sizeof(Dir));
+    strcpy(dir->path, path);
+    dir->sector = headerSector;
+    dir->sectors = new int[divRoundUp(DirectoryFileSize, SectorSize)];
+    if (!Allocate(&hdr, DirectoryFileSize, dir->sectors, &numLeaves))
+    {
+        Error("%s: disk full", path);
+        return;
+    }
+    WriteSector(headerSector, &hdr);
+    dirs[numDirs++] = dir;
+}
+
+//----------------------------------------------------------------------
+// CopyFile
+//	Copy the UNIX file "from" to the Nachos file "to", allocating
+//	its space as FileSystem::Create does.
+//----------------------------------------------------------------------
+
+static void
+CopyFile(const char *from, const char *to)
+{
+    FILE *fp;
+    Header hdr;
+    int sector, numLeaves = 0;
+    FileOffset fileLength;
+    int *leaves;
+    char buf[SectorSize];
+
+    if ((fp = fopen(from, "rb")) == NULL)
+    {
+        Error("%s: can't open", from);
+        return;
+    }
+    fseeko(fp, 0, SEEK_END);
+    fileLength = ftello(fp);
+    fseeko(fp, 0, SEEK_SET);
+
+    if ((sector = AddEntry(to, FALSE)) < 0)
+    {
+        fclose(fp);
+        return;
+    }
+    if (fileLength <= (FileOffset)InlineSize)
+    { // the data goes in the header
+        memset(&hdr, 0, sizeof(Header));
+        hdr.numBytes = fileLength;
+        fread(hdr.dataSectors, 1, fileLength, fp);
+        WriteSector(sector, &hdr);
+        fclose(fp);
+        return;
+    }
+    leaves = new int[divRoundUp(fileLength, SectorSize) + 1];
+    if (!Allocate(&hdr, fileLength, leaves, &numLeaves))
+        Error("%s: disk full", to);
+    else
+    {
+        WriteSector(sector, &hdr);
+        for (int i = 0; i < numLeaves; i++)
+        {
+            memset(buf, 0, SectorSize);
+            fread(buf, 1, SectorSize, fp);
+            WriteSector(leaves[i], buf);
+        }
+    }
+    delete[] leaves;
+    fclose(fp);
+}
+
+//----------------------------------------------------------------------
+// CopyTree
+//	Copy the UNIX directory tree "from" into the new Nachos
+//	directory "to".
+//----------------------------------------------------------------------
+
+static void
+CopyTree(const char *from, const char *to)
+{
+    DIR *dp;
+    struct dirent *entry;
+    struct stat st;
+    char fromPath[512], toPath[512];
+
+    if (strcmp(to, "/") != 0)
+        MakeDir(to, -1);
+    if ((dp = opendir(from)) == NULL)
+    {
+        Error("%s: can't open directory", from);
+        return;
+    }
+    while ((entry = readdir(dp)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        sprintf(fromPath, "%s/%s", from, entry->d_name);
+        sprintf(toPath, "%s/%s", strcmp(to, "/") == 0 ? "" : to, entry->d_name);
+        if (stat(fromPath, &st) == 0 && S_ISDIR(st.st_mode))
+            CopyTree(fromPath, toPath);
+        else
+            CopyFile(fromPath, toPath);
+    }
+    closedir(dp);
+}
+
+//----------------------------------------------------------------------
+// Build
+//	Format "imageName", then carry out the manifest.  This is the
+//	work of FileSystem::FileSystem(TRUE) and Journal::Format,
+//	followed by one Create/CreateDirectory per manifest entry.
+//----------------------------------------------------------------------
+
+static int
+Build(const char *imageName, FILE *manifest)
+{
+    Header mapHdr;
+    int *mapSectors = new int[divRoundUp(FreeMapFileSize(numSectors), SectorSize)];
+    int numMapSectors = 0, magic = MagicNumber;
+    int journal[SectorSize / sizeof(int)];
+    char super[SectorSize];
+    char line[1024], op[16], a[512], b[512];
+
+    if ((image = fopen(imageName, "w+b")) == NULL)
+    {
+        Error("%s: can't create", imageName);
+        return 1;
+    }
+    setvbuf(image, NULL, _IOFBF, 64 * 1024);
+    fwrite(&magic, MagicSize, 1, image);
+    fflush(image);
+    if (ftruncate(fileno(image), MagicSize + (FileOffset)numSectors * SectorSize) != 0)
+    { // full size, but sparse
+        Error("%s: can't make it %d sectors long", imageName, numSectors);
+        return 1;
+    }
+    NewFreeMap();
+
+    memset(super, 0, SectorSize);
+    ((SuperBlock *)super)->magic = SuperMagic;
+    ((SuperBlock *)super)->sectorSize = SectorSize;
+    ((SuperBlock *)super)->sectorsPerTrack = SectorsPerTrack;
+    ((SuperBlock *)super)->numSectors = numSectors;
+    ((SuperBlock *)super)->sectorsPerGroup = SectorsPerGroup;
+    ((SuperBlock *)super)->numGroups = divRoundUp(numSectors, SectorsPerGroup);
+    WriteSector(SuperSector, super);
+
+    Mark(SuperSector);
+    Mark(FreeMapSector);
+    Mark(DirectorySector);
+    for (int i = JournalSector; i <= JournalSector + JournalSize; i++)
+        Mark(i);
+    Allocate(&mapHdr, FreeMapFileSize(numSectors), mapSectors, &numMapSectors);
+    WriteSector(FreeMapSector, &mapHdr);
+    MakeDir("/", DirectorySector);
+
+    memset(journal, 0, sizeof(journal));
+    journal[0] = JournalMagic;
+    journal[1] = 1; // sequence number after Format
+    WriteSector(JournalSector, journal);
+
+    while (fgets(line, sizeof(line), manifest) != NULL)
+    {
+        int n = sscanf(line, "%15s %511s %511s", op, a, b);
+        if (n <= 0 || op[0] == '#')
+            continue;
+        if (strcmp(op, "d") == 0 && n == 2)
+            MakeDir(a, -1);
+        else if (strcmp(op, "f") == 0 && n == 3)
+            CopyFile(a, b);
+        else if (strcmp(op, "r") == 0 && n == 3)
+            CopyTree(a, b);
+        else
+            Error("bad manifest line: %s", line);
+    }
+
+    // everything is allocated: write the directories and the free map
+    for (int i = 0; i < numDirs; i++)
+        for (int j = 0; j * SectorSize < (int)DirectoryFileSize; j++)
+        {
+            char buf[SectorSize];
+            int n = DirectoryFileSize - j * SectorSize;
+            memset(buf, 0, SectorSize);
+            memcpy(buf, (char *)dirs[i]->table + j * SectorSize,
+                   min(n, SectorSize));
+            WriteSector(dirs[i]->sectors[j], buf);
+        }
+    for (int i = 0; i < numMapSectors; i++)
+        WriteSector(mapSectors[i], (char *)freeMap + i * SectorSize);
+
+    fclose(image);
+    delete[] mapSectors;
+    return numErrors > 0;
+}
+
+//----------------------------------------------------------------------
+// Verify state: how many times each sector is referenced, and the
+// free map read from the image.
+//----------------------------------------------------------------------
+
+static unsigned char *refs;
+static bool counting = TRUE; // FALSE once the structure is checked
+static int numFiles = 0, numDirectories = 0;
+
+//----------------------------------------------------------------------
+// Walk
+//	Check the header tree rooted at "sector", counting a reference
+//	to it and every sector below it.  The data sectors, in file
+//	order, are appended to "leaves" if it is non-NULL (HoleSector
+//	for each sector of a hole).  Returns the file length, or -1 if
+//	the header is bad.
+//
+//	"index" is TRUE for the index headers of a file; only the
+//	top-level header can hold inline data.
+//----------------------------------------------------------------------
+
+static FileOffset
+Walk(int sector, const char *path, int *leaves, int *numLeaves, bool index)
+{
+    Header hdr;
+    FileOffset levelSize;
+    int count;
+
+    if (sector < 0 || sector >= numSectors)
+    {
+        Error("%s: header sector out of range", path);
+        return -1;
+    }
+    if (counting)
+        refs[sector]++;
+    ReadSector(sector, &hdr);
+
+    if (hdr.numBytes < 0 || hdr.numBytes > (FileOffset)numSectors * SectorSize)
+    {
+        Error("%s: bad header in sector %d", path, sector);
+        return -1;
+    }
+    if (!index && hdr.numBytes <= (FileOffset)InlineSize)
+        return hdr.numBytes; // no sectors below it
+    levelSize = LevelSize(hdr.numBytes);
+    count = divRoundUp(hdr.numBytes, levelSize);
+
+    for (int i = 0; i < count; i++)
+    {
+        int s = hdr.dataSectors[i];
+        if (s == HoleSector)
+        { // never written; it reads as zeroes
+            FileOffset n = divRoundUp(min(levelSize, hdr.numBytes - i * levelSize),
+                                      SectorSize);
+            while (leaves != NULL && n-- > 0)
+                leaves[(*numLeaves)++] = HoleSector;
+            continue;
+        }
+        if (levelSize != SectorSize)
+        {
+            if (Walk(s, path, leaves, numLeaves, TRUE) < 0)
+                return -1;
+            continue;
+        }
+        if (s < 0 || s >= numSectors)
+        {
+            Error("%s: data sector out of range", path);
+            return -1;
+        }
+        if (counting)
+            refs[s]++;
+        if (leaves != NULL)
+            leaves[(*numLeaves)++] = s;
+    }
+    return hdr.numBytes;
+}
+
+//----------------------------------------------------------------------
+// WalkDir
+//	Check the directory whose header is in "sector", and everything
+//	in it.
+//----------------------------------------------------------------------
+
+static void
+WalkDir(int sector, const char *path)
+{
+    int leaves[divRoundUp(DirectoryFileSize, SectorSize)];
+    int numLeaves = 0;
+    DirectoryEntry table[NumDirEntries];
+    char buf[SectorSize], child[512];
+
+    if (sector >= 0 && sector < numSectors && refs[sector] > 0)
+    {
+        Error("%s: directory is linked more than once", path);
+        return;
+    }
+    if (Walk(sector, path, leaves, &numLeaves, FALSE) != (FileOffset)DirectoryFileSize)
+    {
+        Error("%s: directory has the wrong size", path);
+        return;
+    }
+    numDirectories++;
+    for (int j = 0; j < numLeaves; j++)
+    {
+        int n = DirectoryFileSize - j * SectorSize;
+        if (leaves[j] == HoleSector)
+        {
+            Error("%s: directory has a hole", path);
+            return;
+        }
+        ReadSector(leaves[j], buf);
+        memcpy((char *)table + j * SectorSize, buf, min(n, SectorSize));
+    }
+    for (int i = 0; i < NumDirEntries; i++)
+    {
+        if (!table[i].inUse)
+            continue;
+        table[i].name[FileNameMaxLen] = '\0';
+        sprintf(child, "%s/%s", strcmp(path, "/") == 0 ? "" : path, table[i].name);
+        if (table[i].isDir)
+            WalkDir(table[i].sector, child);
+        else if (Walk(table[i].sector, child, NULL, NULL, FALSE) >= 0)
+            numFiles++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lookup
+//	Return the header sector of the file "path" in the image, or -1.
+//----------------------------------------------------------------------
+
+static int
+Lookup(const char *path)
+{
+    char copy[512], buf[SectorSize];
+    int leaves[divRoundUp(DirectoryFileSize, SectorSize)];
+    DirectoryEntry table[NumDirEntries];
+    int sector = DirectorySector;
+
+    strcpy(copy, path);
+    for (char *name = strtok(copy, "/"); name != NULL; name = strtok(NULL, "/"))
+    {
+        int numLeaves = 0, i;
+        if (Walk(sector, path, leaves, &numLeaves, FALSE) != (FileOffset)DirectoryFileSize)
+            return -1;
+        for (int j = 0; j < numLeaves; j++)
+        {
+            int n = DirectoryFileSize - j * SectorSize;
+            if (leaves[j] == HoleSector)
+                return -1;
+            ReadSector(leaves[j], buf);
+            memcpy((char *)table + j * SectorSize, buf, min(n, SectorSize));
+        }
+        for (i = 0; i < NumDirEntries; i++)
+            if (table[i].inUse && strncmp(table[i].name, name, FileNameMaxLen) == 0)
+                break;
+        if (i == NumDirEntries)
+            return -1;
+        sector = table[i].sector;
+    }
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// Compare
+//	Check that the Nachos file "to" in the image holds the same
+//	bytes as the UNIX file "from".
+//----------------------------------------------------------------------
+
+static void
+Compare(const char *from, const char *to)
+{
+    FILE *fp;
+    int sector, numLeaves = 0;
+    FileOffset length;
+    int *leaves;
+    char buf[SectorSize], host[SectorSize];
+
+    if ((sector = Lookup(to)) < 0)
+    {
+        Error("%s: missing from the image", to);
+        return;
+    }
+    if ((fp = fopen(from, "rb")) == NULL)
+    {
+        Error("%s: can't open", from);
+        return;
+    }
+    fseeko(fp, 0, SEEK_END);
+    leaves = new int[divRoundUp(ftello(fp), SectorSize) + 1];
+    fseeko(fp, 0, SEEK_SET);
+    length = Walk(sector, to, leaves, &numLeaves, FALSE);
+    if (length >= 0 && length <= (FileOffset)InlineSize)
+    {
+        Header hdr;
+        int n = fread(host, 1, SectorSize, fp);
+        ReadSector(sector, &hdr);
+        if (n != length || memcmp(hdr.dataSectors, host, n) != 0)
+            Error("%s: contents differ", to);
+    }
+    else if (length >= 0)
+    {
+        int i;
+        for (i = 0; i < numLeaves; i++)
+        {
+            int n = fread(host, 1, SectorSize, fp);
+            int want = min(length - (FileOffset)i * SectorSize, (FileOffset)SectorSize);
+            if (leaves[i] == HoleSector)
+                memset(buf, 0, SectorSize);
+            else
+                ReadSector(leaves[i], buf);
+            if (n != want || memcmp(buf, host, n) != 0)
+            {
+                Error("%s: contents differ", to);
+                break;
+            }
+        }
+        if (i == numLeaves && fread(host, 1, 1, fp) == 1)
+            Error("%s: shorter than the original", to);
+    }
+    delete[] leaves;
+    fclose(fp);
+}
+
+//----------------------------------------------------------------------
+// CompareTree
+//	Compare every file under the UNIX directory "from" with its copy
+//	under "to".
+//----------------------------------------------------------------------
+
+static void
+CompareTree(const char *from, const char *to)
+{
+    DIR *dp;
+    struct dirent *entry;
+    struct stat st;
+    char fromPath[512], toPath[512];
+
+    if ((dp = opendir(from)) == NULL)
+    {
+        Error("%s: can't open directory", from);
+        return;
+    }
+    while ((entry = readdir(dp)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        sprintf(fromPath, "%s/%s", from, entry->d_name);
+        sprintf(toPath, "%s/%s", strcmp(to, "/") == 0 ? "" : to, entry->d_name);
+        if (stat(fromPath, &st) == 0 && S_ISDIR(st.st_mode))
+            CompareTree(fromPath, toPath);
+        else
+            Compare(fromPath, toPath);
+    }
+    closedir(dp);
+}
+
+//----------------------------------------------------------------------
+// Verify
+//	Check the structure of "imageName": every header tree is well
+//	formed, no sector is used twice, and the free map marks exactly
+//	the sectors in use.  With a manifest, also check that every file
+//	in it was copied correctly.
+//----------------------------------------------------------------------
+
+static int
+Verify(const char *imageName, FILE *manifest)
+{
+    int magic, used = 0, leaked = 0, missing = 0, doubled = 0;
+    int *mapSectors;
+    int numMapSectors = 0;
+    int journal[SectorSize / sizeof(int)];
+    SuperBlock super;
+    char buf[SectorSize];
+    char line[1024], op[16], a[512], b[512];
+
+    if ((image = fopen(imageName, "rb")) == NULL)
+    {
+        Error("%s: can't open", imageName);
+        return 1;
+    }
+    if (fread(&magic, MagicSize, 1, image) != 1 || magic != MagicNumber)
+    {
+        Error("%s: not a Nachos disk", imageName);
+        return 1;
+    }
+
+    // the superblock says how big the file system is
+    ReadSector(SuperSector, buf);
+    memcpy(&super, buf, sizeof(super));
+    if (super.magic != SuperMagic || super.sectorSize != SectorSize)
+    {
+        Error("%s: no superblock (formatted by an older Nachos?)", imageName);
+        return 1;
+    }
+    numSectors = super.numSectors;
+    fseeko(image, 0, SEEK_END);
+    if (ftello(image) < MagicSize + (FileOffset)numSectors * SectorSize)
+        Error("%s: image is shorter than its %d sectors", imageName, numSectors);
+    position = -1;
+    NewFreeMap();
+    refs = new unsigned char[numSectors];
+    memset(refs, 0, numSectors);
+    mapSectors = new int[divRoundUp(FreeMapFileSize(numSectors), SectorSize)];
+    refs[SuperSector]++;
+
+    // a disk formatted before the journal existed has no log area
+    ReadSector(JournalSector, journal);
+    if (journal[0] != JournalMagic)
+        printf("%s: no journal\n", imageName);
+    else
+    {
+        if (journal[2] != 0)
+            printf("%s: journal holds %d sectors to replay; "
+                   "mount it once before checking\n", imageName, journal[2]);
+        for (int i = JournalSector; i <= JournalSector + JournalSize; i++)
+            refs[i]++;
+    }
+    if (Walk(FreeMapSector, "free map", mapSectors, &numMapSectors, FALSE) !=
+        FreeMapFileSize(numSectors))
+        Error("free map has the wrong size");
+    else
+        for (int i = 0; i < numMapSectors; i++)
+            if (mapSectors[i] == HoleSector)
+                Error("free map has a hole");
+            else
+                ReadSector(mapSectors[i], (char *)freeMap + i * SectorSize);
+    WalkDir(DirectorySector, "/");
+
+    for (int i = 0; i < numSectors; i++)
+    {
+        if (refs[i] > 1)
+            doubled++;
+        if (refs[i] > 0 && !Test(i))
+            missing++;
+        if (refs[i] == 0 && Test(i))
+            leaked++;
+        used += refs[i] > 0;
+    }
+    if (doubled > 0)
+        Error("%d sectors are used more than once", doubled);
+    if (missing > 0)
+        Error("%d sectors in use are free in the free map", missing);
+    if (leaked > 0)
+        Error("%d sectors are marked in the free map but not used", leaked);
+    printf("%s: %d files, %d directories, %d of %d sectors in use "
+           "(%d doubly used, %d not marked, %d leaked)\n",
+           imageName, numFiles, numDirectories, used, numSectors,
+           doubled, missing, leaked);
+    counting = FALSE;
+
+    while (manifest != NULL && fgets(line, sizeof(line), manifest) != NULL)
+    {
+        int n = sscanf(line, "%15s %511s %511s", op, a, b);
+        if (n <= 0 || op[0] == '#')
+            continue;
+        if (strcmp(op, "d") == 0 && n == 2)
+        {
+            if (Lookup(a) < 0)
+                Error("%s: missing from the image", a);
+        }
+        else if (strcmp(op, "f") == 0 && n == 3)
+            Compare(a, b);
+        else if (strcmp(op, "r") == 0 && n == 3)
+            CompareTree(a, b);
+    }
+
+    fclose(image);
+    if (numErrors == 0)
+        printf("%s: OK\n", imageName);
+    return numErrors > 0;
+}
+
+//----------------------------------------------------------------------
+// main
+//----------------------------------------------------------------------
+
+int
+main(int argc, char **argv)
+{
+    const char *imageName = "DISK_0";
+    bool verify = FALSE;
+    FILE *manifest = NULL;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            imageName = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        { // megabytes, rounded up to whole tracks, as "nachos -ds"
+            int megabytes = atoi(argv[++i]);
+            numSectors = divRoundUp(megabytes * (1024 * 1024 / SectorSize),
+                                    SectorsPerTrack) * SectorsPerTrack;
+            if (numSectors <= JournalSector + JournalSize)
+            {
+                fprintf(stderr, "mkfs: %s: too small\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc)
+        {
+            verify = TRUE;
+            imageName = argv[++i];
+        }
+        else
+            break;
+    }
+    if (i < argc)
+    {
+        if (strcmp(argv[i], "-") == 0)
+            manifest = stdin;
+        else if ((manifest = fopen(argv[i], "r")) == NULL)
+        {
+            fprintf(stderr, "mkfs: %s: can't open\n", argv[i]);
+            return 1;
+        }
+        i++;
+    }
+    if (i != argc || (!verify && manifest == NULL))
+    {
+        fprintf(stderr, "Usage: mkfs [-o image] [-s megabytes] manifest\n");
+        fprintf(stderr, "       mkfs -v image [manifest]\n");
+        return 1;
+    }
+
+    return verify ? Verify(imageName, manifest) : Build(imageName, manifest);
+}